@@ -111,6 +111,7 @@ class NetworkInterfaceAdapter : public TCPOverIPv4Adapter {
         send_pending();
     }
     void tick(const size_t ms_since_last_tick) {
+        TCPOverIPv4Adapter::tick(ms_since_last_tick);
         _interface.tick(ms_since_last_tick);
         send_pending();
     }
@@ -0,0 +1,189 @@
+#include "route_table.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t num_routes = 1'000'000;
+constexpr size_t num_lookups = 20'000'000;
+constexpr size_t num_checks = 200;
+constexpr size_t num_updates = 2000;
+
+//! A prefix length with roughly the distribution of a full Internet routing table (mostly /24s)
+uint8_t random_prefix_length(mt19937 &rng) {
+    const unsigned r = rng() % 100;
+    if (r < 58) {
+        return 24;
+    }
+    if (r < 80) {
+        return 20 + rng() % 4;
+    }
+    if (r < 97) {
+        return 12 + rng() % 8;
+    }
+    if (r < 99) {
+        return 8 + rng() % 4;
+    }
+    return 25 + rng() % 8;
+}
+
+//! Longest-prefix match by scanning every route, as the Router used to
+const RouteInfo *linear_lookup(const vector<RouteInfo> &routes, const uint32_t address) {
+    const RouteInfo *best = nullptr;
+    for (const auto &route : routes) {
+        const unsigned shift = 32 - route.prefix_length;
+        if (shift != 32 and (address >> shift) != (route.route_prefix >> shift)) {
+            continue;
+        }
+        if (best == nullptr or route.prefix_length > best->prefix_length) {
+            best = &route;
+        }
+    }
+    return best;
+}
+
+//! Check `table` against a linear scan of `routes` for each of `addresses`
+void check_against_linear_scan(const RouteTable &table,
+                               const vector<RouteInfo> &routes,
+                               const vector<uint32_t> &addresses) {
+    for (const auto address : addresses) {
+        const RouteInfo *expected = linear_lookup(routes, address);
+        const RouteInfo *actual = table.lookup(address);
+        if ((expected == nullptr) != (actual == nullptr) or
+            (expected and (expected->route_prefix != actual->route_prefix or
+                           expected->prefix_length != actual->prefix_length))) {
+            throw runtime_error("route table disagrees with linear scan for address " + to_string(address));
+        }
+    }
+}
+
+void main_loop() {
+    mt19937 rng{12345};
+
+    vector<RouteInfo> routes;
+    unordered_set<uint64_t> seen;
+    routes.reserve(num_routes);
+    while (routes.size() < num_routes) {
+        const uint8_t len = random_prefix_length(rng);
+        const uint32_t prefix = uint32_t(rng()) & (0xffff'ffff << (32 - len));
+        if (seen.insert((uint64_t(prefix) << 8) | len).second) {
+            routes.push_back({prefix, len, {{{}, routes.size() % 16}}});
+        }
+    }
+
+    RouteTableWriter writer;
+    const auto build_start = steady_clock::now();
+    for (const auto &route : routes) {
+        writer.add(route);
+    }
+    const shared_ptr<const RouteTable> table = writer.snapshot();
+    const auto build_end = steady_clock::now();
+
+    vector<uint32_t> addresses(1 << 16);
+    for (auto &address : addresses) {
+        address = rng();
+    }
+
+    // spot-check the table against a linear scan (also timing the scan, for comparison)
+    const vector<uint32_t> check_addresses(addresses.begin(), addresses.begin() + num_checks);
+    const auto check_start = steady_clock::now();
+    check_against_linear_scan(*table, routes, check_addresses);
+    const auto check_end = steady_clock::now();
+
+    size_t matched = 0;
+    const auto lookup_start = steady_clock::now();
+    for (size_t i = 0; i < num_lookups; i++) {
+        matched += table->lookup(addresses[i & 0xffff]) != nullptr;
+    }
+    const auto lookup_end = steady_clock::now();
+
+    // batched lookups must agree with one-at-a-time lookups
+    vector<const RouteInfo *> matches(addresses.size());
+    table->lookup_batch(addresses.data(), matches.data(), addresses.size());
+    for (size_t i = 0; i < addresses.size(); i++) {
+        if (matches[i] != table->lookup(addresses[i])) {
+            throw runtime_error("batched lookup disagrees with lookup() for address " + to_string(addresses[i]));
+        }
+    }
+
+    size_t batch_matched = 0;
+    const size_t batch_lookups = num_lookups / addresses.size() * addresses.size();
+    const auto batch_start = steady_clock::now();
+    for (size_t i = 0; i < batch_lookups; i += addresses.size()) {
+        table->lookup_batch(addresses.data(), matches.data(), addresses.size());
+        for (const auto match : matches) {
+            batch_matched += match != nullptr;
+        }
+    }
+    const auto batch_end = steady_clock::now();
+
+    // route churn: withdraw routes one at a time, publishing a new snapshot after each
+    vector<uint32_t> churned_addresses;
+    vector<uint8_t> churned_lengths;
+    const auto churn_start = steady_clock::now();
+    shared_ptr<const RouteTable> latest = table;
+    for (size_t i = 0; i < num_updates; i++) {
+        const size_t victim = rng() % routes.size();
+        const RouteInfo route = routes[victim];
+        routes[victim] = routes.back();
+        routes.pop_back();
+
+        const uint32_t host_bits = route.prefix_length == 32 ? 0 : uint32_t(rng()) >> route.prefix_length;
+        churned_addresses.push_back(route.route_prefix | host_bits);
+        churned_lengths.push_back(route.prefix_length);
+
+        if (not writer.remove(route.route_prefix, route.prefix_length)) {
+            throw runtime_error("route to remove wasn't in the table");
+        }
+        latest = writer.snapshot();
+    }
+    const auto churn_end = steady_clock::now();
+
+    // the new snapshot reflects the withdrawals, while the original one is untouched
+    check_against_linear_scan(
+        *latest, routes, vector<uint32_t>(churned_addresses.begin(), churned_addresses.begin() + num_checks));
+    for (size_t i = 0; i < churned_addresses.size(); i++) {
+        const RouteInfo *route = table->lookup(churned_addresses[i]);
+        if (route == nullptr or route->prefix_length < churned_lengths[i]) {
+            throw runtime_error("a route change leaked into an older snapshot");
+        }
+    }
+
+    const double build_seconds = duration<double>(build_end - build_start).count();
+    const double linear_seconds = duration<double>(check_end - check_start).count();
+    const double lookup_seconds = duration<double>(lookup_end - lookup_start).count();
+    const double batch_seconds = duration<double>(batch_end - batch_start).count();
+    const double churn_seconds = duration<double>(churn_end - churn_start).count();
+
+    cout << fixed << setprecision(2);
+    cout << "Loaded " << table->size() << " routes in " << build_seconds << " s (" << table->node_count()
+         << " trie nodes)\n";
+    cout << "Linear scan:  " << num_checks / linear_seconds << " lookups/s\n";
+    cout << "Route table:  " << num_lookups / lookup_seconds / 1e6 << " million lookups/s (" << matched
+         << " matched)\n";
+    cout << "Batched:      " << batch_lookups / batch_seconds / 1e6 << " million lookups/s (" << batch_matched
+         << " matched)\n";
+    cout << "Route churn:  " << num_updates / churn_seconds << " withdrawals/s, each published as a snapshot\n";
+}
+
+int main() {
+    try {
+        main_loop();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -1,3 +1,4 @@
+#include "buffer.hh"
 #include "tcp_connection.hh"
 
 #include <chrono>
@@ -107,6 +108,10 @@ int main() {
     try {
         main_loop(false);
         main_loop(true);
+
+        const auto &pool = BufferPool::stats();
+        cout << "Buffer pool: " << pool.hits << " hits, " << pool.misses << " misses, " << pool.oversized
+             << " oversized\n";
     } catch (const exception &e) {
         cerr << e.what() << "\n";
         return EXIT_FAILURE;
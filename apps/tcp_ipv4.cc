@@ -54,6 +54,10 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
 
 static tuple<TCPConfig, FdAdapterConfig, bool, char *> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
+    // start with the conservative MSS, and probe for as much as an Ethernet MTU allows
+    c_fsm.mss_probe_limit = NetworkInterface::DEFAULT_MTU - IPv4Header::LENGTH - TCPHeader::LENGTH;
+    c_fsm.ack_delay = TCPConfig::DELAYED_ACK_TIMEOUT;
+    c_fsm.sws_avoidance = true;
     FdAdapterConfig c_filt{};
     char *tundev = nullptr;
 
@@ -48,6 +48,8 @@ static void check_argc(int argc, char **argv, int curr, const char *err) {
 
 static tuple<TCPConfig, FdAdapterConfig, bool> get_config(int argc, char **argv) {
     TCPConfig c_fsm{};
+    c_fsm.ack_delay = TCPConfig::DELAYED_ACK_TIMEOUT;
+    c_fsm.sws_avoidance = true;
     FdAdapterConfig c_filt{};
 
     int curr = 1;
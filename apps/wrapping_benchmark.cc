@@ -0,0 +1,105 @@
+#include "wrapping_integers.hh"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace std::chrono;
+
+constexpr size_t num_unwraps = 1 << 28;
+constexpr size_t num_seqnos = 1 << 16;
+constexpr size_t batch_size = 256;
+
+//! unwrap() as it was written before it lost its branches, for comparison
+uint64_t branchy_unwrap(const WrappingInt32 n, const WrappingInt32 isn, const uint64_t checkpoint) {
+    const uint64_t offset = n.raw_value() - isn.raw_value();
+    const uint64_t lower = offset + ((checkpoint >> 32) << 32);
+    uint64_t below = lower;
+    uint64_t above = lower;
+    if (lower < checkpoint) {
+        above = lower + (1ul << 32);
+    } else if (lower < (1ul << 32)) {
+        return lower;
+    } else {
+        below = lower - (1ul << 32);
+    }
+    return checkpoint - below < above - checkpoint ? below : above;
+}
+
+void main_loop() {
+    mt19937 rng{12345};
+
+    // seqnos within a window either side of a checkpoint, as a receiver or sender sees them
+    const uint64_t checkpoint = (uint64_t{7} << 32) + 12345;
+    const WrappingInt32 isn{uint32_t(rng())};
+    vector<WrappingInt32> seqnos;
+    for (size_t i = 0; i < num_seqnos; i++) {
+        seqnos.push_back(wrap(checkpoint + (rng() % 131072) - 65536, isn));
+    }
+
+    vector<uint64_t> absolute(num_seqnos);
+    unwrap_n(seqnos.data(), seqnos.size(), isn, checkpoint, absolute.data());
+    for (size_t i = 0; i < num_seqnos; i++) {
+        if (absolute[i] != unwrap(seqnos[i], isn, checkpoint) or
+            absolute[i] != branchy_unwrap(seqnos[i], isn, checkpoint)) {
+            throw runtime_error("unwrap disagrees for seqno " + to_string(seqnos[i].raw_value()));
+        }
+    }
+
+    uint64_t branchy_sum = 0;
+    const auto branchy_start = steady_clock::now();
+    for (size_t i = 0; i < num_unwraps; i++) {
+        branchy_sum += branchy_unwrap(seqnos[i % num_seqnos], isn, checkpoint);
+    }
+    const auto branchy_end = steady_clock::now();
+
+    uint64_t sum = 0;
+    const auto unwrap_start = steady_clock::now();
+    for (size_t i = 0; i < num_unwraps; i++) {
+        sum += unwrap(seqnos[i % num_seqnos], isn, checkpoint);
+    }
+    const auto unwrap_end = steady_clock::now();
+
+    uint64_t batch_sum = 0;
+    const auto batch_start = steady_clock::now();
+    // in batches of the size of a retransmission queue, say, or a segment's SACK blocks
+    for (size_t i = 0; i < num_unwraps; i += batch_size) {
+        unwrap_n(&seqnos[i % num_seqnos], batch_size, isn, checkpoint, absolute.data());
+        for (size_t j = 0; j < batch_size; j++) {
+            batch_sum += absolute[j];
+        }
+    }
+    const auto batch_end = steady_clock::now();
+
+    if (branchy_sum != sum or sum != batch_sum) {
+        throw runtime_error("unwrap variants disagree");
+    }
+
+    const double branchy_seconds = duration<double>(branchy_end - branchy_start).count();
+    const double unwrap_seconds = duration<double>(unwrap_end - unwrap_start).count();
+    const double batch_seconds = duration<double>(batch_end - batch_start).count();
+
+    cout << fixed << setprecision(2);
+    cout << "Branchy unwrap: " << num_unwraps / branchy_seconds / 1e6 << " million unwraps/s\n";
+    cout << "unwrap:         " << num_unwraps / unwrap_seconds / 1e6 << " million unwraps/s\n";
+    cout << "unwrap_n:       " << num_unwraps / batch_seconds / 1e6 << " million unwraps/s (batches of " << batch_size
+         << ")\n";
+}
+
+int main() {
+    try {
+        main_loop();
+    } catch (const exception &e) {
+        cerr << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -6,6 +6,7 @@ add_test(NAME t_wrapping_ints_cmp         COMMAND wrapping_integers_cmp)
 add_test(NAME t_wrapping_ints_unwrap      COMMAND wrapping_integers_unwrap)
 add_test(NAME t_wrapping_ints_wrap        COMMAND wrapping_integers_wrap)
 add_test(NAME t_wrapping_ints_roundtrip   COMMAND wrapping_integers_roundtrip)
+add_test(NAME t_wrapping_ints_batch       COMMAND wrapping_integers_batch)
 
 add_test(NAME t_recv_connect         COMMAND recv_connect)
 add_test(NAME t_recv_transmit        COMMAND recv_transmit)
@@ -36,12 +37,16 @@ add_test(NAME t_byte_stream_one_write    COMMAND byte_stream_one_write)
 add_test(NAME t_byte_stream_two_writes   COMMAND byte_stream_two_writes)
 add_test(NAME t_byte_stream_capacity     COMMAND byte_stream_capacity)
 add_test(NAME t_byte_stream_many_writes  COMMAND byte_stream_many_writes)
+add_test(NAME t_byte_stream_storage      COMMAND byte_stream_storage)
 
 add_test(NAME t_webget               COMMAND "${PROJECT_SOURCE_DIR}/tests/webget_t.sh")
 
 add_test(NAME arp_network_interface    COMMAND net_interface)
+add_test(NAME arp_neighbor_table       COMMAND neighbor_table)
 
 add_test(NAME router_test    COMMAND network_simulator)
+add_test(NAME router_threads COMMAND router_threads)
+add_test(NAME router_ecmp    COMMAND router_ecmp)
 
 add_test(NAME t_tcp_parser           COMMAND tcp_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
 add_test(NAME t_ipv4_parser          COMMAND ipv4_parser "${PROJECT_SOURCE_DIR}/tests/ipv4_parser.data")
@@ -62,6 +67,17 @@ add_test(NAME t_retx_win             COMMAND fsm_retx_win)
 add_test(NAME t_loopback             COMMAND fsm_loopback)
 add_test(NAME t_loopback_win         COMMAND fsm_loopback_win)
 add_test(NAME t_reorder              COMMAND fsm_reorder)
+add_test(NAME t_segment_allocs       COMMAND fsm_segment_allocs)
+add_test(NAME t_ipv4_fragments       COMMAND ipv4_fragments)
+add_test(NAME t_tcp_pmtu             COMMAND tcp_pmtu)
+add_test(NAME t_delayed_ack          COMMAND tcp_delayed_ack)
+add_test(NAME t_nagle                COMMAND tcp_nagle)
+add_test(NAME t_pacing               COMMAND tcp_pacing)
+add_test(NAME t_rwnd_tuning          COMMAND tcp_rwnd_tuning)
+add_test(NAME t_sws                  COMMAND tcp_sws)
+add_test(NAME t_listener             COMMAND tcp_listener)
+add_test(NAME t_syn_cookies          COMMAND tcp_syn_cookies)
+add_test(NAME t_keepalive            COMMAND tcp_keepalive)
 
 add_test(NAME t_address_dt           COMMAND address_dt)
 add_test(NAME t_parser_dt            COMMAND parser_dt)
@@ -1,6 +1,7 @@
 #ifndef SPONGE_LIBSPONGE_BYTE_STREAM_HH
 #define SPONGE_LIBSPONGE_BYTE_STREAM_HH
 
+#include <memory>
 #include <string>
 #include "buffer.hh"
 
@@ -17,9 +18,16 @@ class ByteStream {
     // all, but if any of your tests are taking longer than a second,
     // that's a sign that you probably want to keep exploring
     // different approaches.
-    const size_t _capacity;
+    //! Gives a stream's storage back to the BufferPool
+    struct StorageReleaser {
+        void operator()(BufferList *storage) const { BufferPool::release_list(storage); }
+    };
+
+    size_t _capacity;
     size_t _written, _popped;
-    BufferList _buffer;
+    //! The bytes in the stream: taken from the BufferPool on the first write, and given back once drained,
+    //! so an idle stream holds no memory beyond the ByteStream itself
+    std::unique_ptr<BufferList, StorageReleaser> _buffer{};
     bool _error{};  //!< Flag indicating that the stream suffered an error.
     bool _input_ended{};
 
@@ -40,6 +48,12 @@ class ByteStream {
     //! \returns the number of additional bytes that the stream has space for
     size_t remaining_capacity() const;
 
+    //! Change the number of bytes the stream has room for (never to less than it holds now)
+    void set_capacity(const size_t capacity);
+
+    //! \returns the number of bytes the stream has room for
+    size_t capacity() const { return _capacity; }
+
     //! Signal that the byte stream has reached its ending
     void end_input();
 
@@ -61,6 +75,9 @@ class ByteStream {
     //! \returns a string
     std::string read(const size_t len);
 
+    //! Read the next "len" bytes of the stream into a Buffer, copying them just once
+    Buffer read_buffer(const size_t len);
+
     //! \returns `true` if the stream input has ended
     bool input_ended() const;
 
@@ -0,0 +1,77 @@
+#include "neighbor_table.hh"
+
+#include <utility>
+
+using namespace std;
+
+void NeighborTable::_grow() {
+    vector<Slot> old_slots(size_t(1) << (_bits + 1));
+    swap(old_slots, _slots);
+    _bits++;
+
+    for (auto &slot : old_slots) {
+        if (slot.used) {
+            size_t i = _home(slot.ip);
+            while (_slots[i].used) {
+                i = (i + 1) & (_slots.size() - 1);
+            }
+            _slots[i] = move(slot);
+        }
+    }
+}
+
+Neighbor *NeighborTable::find(const uint32_t ip) {
+    for (size_t i = _home(ip); _slots[i].used; i = (i + 1) & (_slots.size() - 1)) {
+        if (_slots[i].ip == ip) {
+            return &_slots[i].neighbor;
+        }
+    }
+    return nullptr;
+}
+
+Neighbor &NeighborTable::operator[](const uint32_t ip) {
+    size_t i = _home(ip);
+    for (; _slots[i].used; i = (i + 1) & (_slots.size() - 1)) {
+        if (_slots[i].ip == ip) {
+            return _slots[i].neighbor;
+        }
+    }
+
+    if (2 * (_size + 1) > _slots.size()) {
+        _grow();
+        return (*this)[ip];
+    }
+
+    _slots[i].used = true;
+    _slots[i].ip = ip;
+    _size++;
+    return _slots[i].neighbor;
+}
+
+//! \details Rather than leaving a tombstone, later slots in the same run move back into the gap if
+//! that's no further from their home slot, so searches never have to skip over removed neighbors.
+void NeighborTable::erase(const uint32_t ip) {
+    const size_t mask = _slots.size() - 1;
+
+    size_t gap = _home(ip);
+    for (; _slots[gap].used; gap = (gap + 1) & mask) {
+        if (_slots[gap].ip == ip) {
+            break;
+        }
+    }
+    if (not _slots[gap].used) {
+        return;
+    }
+
+    for (size_t i = (gap + 1) & mask; _slots[i].used; i = (i + 1) & mask) {
+        // can the neighbor in slot i move back to the gap? only if its home isn't cyclically in (gap, i]
+        const size_t home = _home(_slots[i].ip);
+        if (((i - home) & mask) >= ((i - gap) & mask)) {
+            _slots[gap] = move(_slots[i]);
+            gap = i;
+        }
+    }
+
+    _slots[gap] = Slot{};
+    _size--;
+}
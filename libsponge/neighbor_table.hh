@@ -0,0 +1,57 @@
+#ifndef SPONGE_LIBSPONGE_NEIGHBOR_TABLE_HH
+#define SPONGE_LIBSPONGE_NEIGHBOR_TABLE_HH
+
+#include "ethernet_header.hh"
+#include "ipv4_datagram.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+//! What a NetworkInterface knows about one neighbor (an IP address on its link)
+struct Neighbor {
+    std::optional<EthernetAddress> ethernet_address{};  //!< Its Ethernet address, once learned
+    size_t expires_at{};                                //!< When a learned Ethernet address goes stale
+    std::optional<size_t> requested_at{};               //!< When an ARP request for it was last sent
+    std::vector<InternetDatagram> pending{};            //!< Datagrams waiting for its Ethernet address, oldest first
+    size_t pending_bytes{};                             //!< Total length of the `pending` datagrams
+    std::optional<size_t> timer_at{};                   //!< When its live expiry timer fires, if it has one
+};
+
+//! \brief The neighbors of a NetworkInterface, by IPv4 address
+//! \details An open-addressing hash table with linear probing, kept at most half full, so finding a
+//! neighbor usually costs a single probe. Adding or removing a neighbor may move the others, so a
+//! Neighbor pointer or reference is only good until the next call to operator[]() or erase().
+class NeighborTable {
+    struct Slot {
+        bool used{false};
+        uint32_t ip{};
+        Neighbor neighbor{};
+    };
+
+    std::vector<Slot> _slots = std::vector<Slot>(16);
+    unsigned _bits{4};  //!< log2 of the number of slots
+    size_t _size{0};    //!< Slots in use
+
+    //! The slot where the search for `ip` starts (Fibonacci hashing, to spread out consecutive addresses)
+    size_t _home(const uint32_t ip) const { return (uint64_t(ip) * 0x9e37'79b9'7f4a'7c15) >> (64 - _bits); }
+
+    //! Double the number of slots
+    void _grow();
+
+  public:
+    //! The neighbor with address `ip`, or nullptr if there is none
+    Neighbor *find(const uint32_t ip);
+
+    //! The neighbor with address `ip`, first adding it (knowing nothing) if there is none
+    Neighbor &operator[](const uint32_t ip);
+
+    //! Forget the neighbor with address `ip`, if there is one
+    void erase(const uint32_t ip);
+
+    //! Number of neighbors
+    size_t size() const { return _size; }
+};
+
+#endif  // SPONGE_LIBSPONGE_NEIGHBOR_TABLE_HH
@@ -4,7 +4,8 @@
 #include "ethernet_frame.hh"
 
 #include <iostream>
-#include <set>
+#include <stdexcept>
+#include <vector>
 
 // Dummy implementation of a network interface
 // Translates from {IP datagram, next hop address} to link-layer frame, and from link-layer frame to IP datagram
@@ -30,40 +31,50 @@ void NetworkInterface::send_datagram(const InternetDatagram &dgram, const Addres
     // convert IP address of next hop to raw 32-bit representation (used in ARP header)
     const uint32_t next_hop_ip = next_hop.ipv4_numeric();
 
-    EthernetFrame sendingFrame;
-    
-    if (this->_ip_to_ether.find(next_hop_ip) == this->_ip_to_ether.cend()){
-        if (this->_broadcast_timer.find(next_hop_ip) != this->_broadcast_timer.cend()){
-            if (this->_broadcast_timer[next_hop_ip] < this->_broadcast_resend_time){
-                this->_payload_to_send[next_hop_ip].push(dgram);
-                return;
-            }
+    if (dgram.header().len > this->_mtu){
+        if (dgram.header().df){
+            this->_stats.dropped_too_big++;
+            return;
         }
 
-        ARPMessage arpMsg;
-        arpMsg.opcode = ARPMessage::OPCODE_REQUEST;
-        arpMsg.sender_ethernet_address = this->_ethernet_address;
-        arpMsg.sender_ip_address = this->_ip_address.ipv4_numeric();
-        arpMsg.target_ip_address = next_hop_ip;
+        // each fragment fits, so goes through the rest of this method on its own
+        const vector<InternetDatagram> fragments = dgram.fragment(this->_mtu);
+        this->_stats.datagrams_fragmented++;
+        this->_stats.fragments_created += fragments.size();
+        for (const auto &fragment : fragments){
+            this->send_datagram(fragment, next_hop);
+        }
+        return;
+    }
 
-        sendingFrame.header().dst = ETHERNET_BROADCAST;
-        sendingFrame.header().src = this->_ethernet_address;
-        sendingFrame.header().type = EthernetHeader::TYPE_ARP;
-        sendingFrame.payload() = {arpMsg.serialize()};
+    Neighbor &neighbor = this->_neighbors[next_hop_ip];
+    if (neighbor.ethernet_address.has_value()){
+        this->_send_ipv4(dgram, neighbor.ethernet_address.value());
+        return;
+    }
 
-        this->_frames_out.push(sendingFrame);
+    this->_enqueue(neighbor, dgram);
+    if (neighbor.requested_at.has_value()){
+        return;
+    }
 
-        this->_broadcast_timer[next_hop_ip] = 0;
-        this->_payload_to_send[next_hop_ip] = queue<InternetDatagram>();
-        this->_payload_to_send[next_hop_ip].push(dgram);
+    ARPMessage arpMsg;
+    arpMsg.opcode = ARPMessage::OPCODE_REQUEST;
+    arpMsg.sender_ethernet_address = this->_ethernet_address;
+    arpMsg.sender_ip_address = this->_ip_address.ipv4_numeric();
+    arpMsg.target_ip_address = next_hop_ip;
 
-    }else{
-        sendingFrame.header().dst = this->_ip_to_ether[next_hop_ip];
-        sendingFrame.header().src = this->_ethernet_address;
-        sendingFrame.header().type = EthernetHeader::TYPE_IPv4;
-        sendingFrame.payload() = dgram.serialize();
-        this->_frames_out.push(sendingFrame);
-    }
+    EthernetFrame sendingFrame;
+    sendingFrame.header().dst = ETHERNET_BROADCAST;
+    sendingFrame.header().src = this->_ethernet_address;
+    sendingFrame.header().type = EthernetHeader::TYPE_ARP;
+    sendingFrame.payload() = {arpMsg.serialize()};
+    this->_frames_out.push(sendingFrame);
+    this->_stats.arp_requests_sent++;
+
+    // if nobody answers in time, the datagrams are dropped and the next one sends a new request
+    neighbor.requested_at = this->_now;
+    this->_schedule(neighbor, next_hop_ip, this->_now + this->_broadcast_resend_time);
 }
 
 //! \param[in] frame the incoming Ethernet frame
@@ -84,10 +95,14 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
             return nullopt;
         }
 
+        // learn (or refresh) the sender's mapping, whatever the message
+        Neighbor &neighbor = this->_neighbors[arpMsg.sender_ip_address];
+        neighbor.ethernet_address = arpMsg.sender_ethernet_address;
+        neighbor.expires_at = this->_now + this->_mapping_expiration_time;
+        neighbor.requested_at.reset();
+        this->_schedule(neighbor, arpMsg.sender_ip_address, neighbor.expires_at);
+
         if (arpMsg.opcode == ARPMessage::OPCODE_REQUEST){
-            this->_ip_to_ether[arpMsg.sender_ip_address] = arpMsg.sender_ethernet_address;
-            this->_ip_mapping_timer[arpMsg.sender_ip_address] = 0;
-            
             if (arpMsg.target_ip_address != this->_ip_address.ipv4_numeric()){
                 return nullopt;
             }
@@ -107,53 +122,141 @@ optional<InternetDatagram> NetworkInterface::recv_frame(const EthernetFrame &fra
             replyFrame.payload() = {replyMsg.serialize()};
 
             this->_frames_out.push(replyFrame);
-        }else{
-            this->_ip_to_ether[arpMsg.sender_ip_address] = arpMsg.sender_ethernet_address;
-            this->_ip_mapping_timer[arpMsg.sender_ip_address] = 0;
         }
 
-        _flush();
+        this->_flush(arpMsg.sender_ip_address);
         return nullopt;
     }
 }
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
-void NetworkInterface::tick(const size_t ms_since_last_tick) { 
-    set<uint32_t> to_delete;
-    for (auto p = this->_ip_mapping_timer.begin(); p != this->_ip_mapping_timer.cend(); p ++){
-        p->second += ms_since_last_tick;
-        if (p->second >= this->_mapping_expiration_time){
-            to_delete.insert(to_delete.end(), p->first);
+void NetworkInterface::tick(const size_t ms_since_last_tick) {
+    this->_now += ms_since_last_tick;
+
+    while (!this->_expiry_timers.empty() && this->_expiry_timers.top().first <= this->_now){
+        const auto [deadline, ip] = this->_expiry_timers.top();
+        this->_expiry_timers.pop();
+
+        Neighbor *neighbor = this->_neighbors.find(ip);
+        if (neighbor == nullptr || neighbor->timer_at != deadline){
+            continue;
+        }
+        neighbor->timer_at.reset();
+
+        if (neighbor->ethernet_address.has_value()){
+            // forget a mapping that hasn't been refreshed, or wait for the refreshed one to go stale
+            if (neighbor->expires_at <= this->_now){
+                this->_neighbors.erase(ip);
+            }else{
+                this->_schedule(*neighbor, ip, neighbor->expires_at);
+            }
+        }else if (neighbor->requested_at.has_value()){
+            const size_t given_up_at = neighbor->requested_at.value() + this->_broadcast_resend_time;
+            if (given_up_at <= this->_now){
+                // nobody answered the request: give up on the datagrams waiting for it
+                this->_stats.pending_datagrams -= neighbor->pending.size();
+                this->_stats.pending_bytes -= neighbor->pending_bytes;
+                this->_stats.dropped_unresolved += neighbor->pending.size();
+                this->_neighbors.erase(ip);
+            }else{
+                this->_schedule(*neighbor, ip, given_up_at);
+            }
         }
     }
+}
+
+//! \details A refresh only ever moves a neighbor's deadline later, so it usually leaves the live timer as it is,
+//! and the heap holds about one timer per neighbor however often the neighbors are heard from.
+void NetworkInterface::_schedule(Neighbor &neighbor, const uint32_t ip, const size_t deadline){
+    if (neighbor.timer_at.has_value() && neighbor.timer_at.value() <= deadline){
+        return;
+    }
+    neighbor.timer_at = deadline;
+    this->_expiry_timers.push({deadline, ip});
+}
 
-    for (auto ip : to_delete){
-        this->_ip_mapping_timer.erase(ip);
-        this->_ip_to_ether.erase(ip);
+//! \param[in] mtu the largest datagram, header included, to send without fragmenting it
+void NetworkInterface::set_mtu(const size_t mtu){
+    if (mtu < 68){
+        throw runtime_error("NetworkInterface: MTU must be at least 68 bytes");
     }
-    
-    for (auto p = this->_broadcast_timer.begin(); p != this->_broadcast_timer.cend(); p ++){
-        p->second += ms_since_last_tick;
+    this->_mtu = mtu;
+}
+
+//! \details This is how a datagram built in place goes out without being serialized into a frame first.
+bool NetworkInterface::frame_into(Headroom &room, const size_t dgram_len, const Address &next_hop){
+    if (dgram_len > this->_mtu) return false;
+
+    const Neighbor *neighbor = this->_neighbors.find(next_hop.ipv4_numeric());
+    if (neighbor == nullptr || !neighbor->ethernet_address.has_value()) return false;
+
+    EthernetHeader header;
+    header.dst = neighbor->ethernet_address.value();
+    header.src = this->_ethernet_address;
+    header.type = EthernetHeader::TYPE_IPv4;
+    header.serialize_into(room.prepend(EthernetHeader::LENGTH), EthernetHeader::LENGTH);
+    return true;
+}
+
+void NetworkInterface::_send_ipv4(const InternetDatagram &dgram, const EthernetAddress &dst){
+    EthernetFrame sendingFrame;
+    sendingFrame.header().dst = dst;
+    sendingFrame.header().src = this->_ethernet_address;
+    sendingFrame.header().type = EthernetHeader::TYPE_IPv4;
+    sendingFrame.payload() = dgram.serialize();
+    this->_frames_out.push(sendingFrame);
+}
+
+void NetworkInterface::_flush(const uint32_t ip){
+    Neighbor *neighbor = this->_neighbors.find(ip);
+    if (neighbor == nullptr || !neighbor->ethernet_address.has_value()){
+        return;
     }
+
+    for (const auto &dgram : neighbor->pending){
+        this->_send_ipv4(dgram, neighbor->ethernet_address.value());
+    }
+    this->_stats.pending_datagrams -= neighbor->pending.size();
+    this->_stats.pending_bytes -= neighbor->pending_bytes;
+
+    // give back the queue's memory too, not just its contents
+    vector<InternetDatagram>().swap(neighbor->pending);
+    neighbor->pending_bytes = 0;
 }
 
-void NetworkInterface::_flush(){
-    set<uint32_t> to_delete;
-    for (auto p = this->_payload_to_send.begin(); p != this->_payload_to_send.cend(); p ++){
-        if (this->_ip_to_ether.find(p->first) != this->_ip_to_ether.cend()){
-            Address addr = Address::from_ipv4_numeric(p->first);
-            while (!p->second.empty()){
-                auto payload = p->second.front();
-                this->send_datagram(payload, addr);
-                p->second.pop();
-            }
-        }
+//! \details A neighbor over its limits drops its oldest datagrams, as newer ones are likelier to still be
+//! of use once the address is learned (though a datagram too big for the limits on its own is dropped
+//! instead). When the interface's limits, shared by all neighbors, are reached, the new datagram is dropped.
+void NetworkInterface::_enqueue(Neighbor &neighbor, const InternetDatagram &dgram){
+    const size_t size = dgram.header().len;
+    if (size > this->_max_pending_bytes){
+        this->_stats.dropped_neighbor_full++;
+        return;
     }
 
-    for (auto ip : to_delete){
-        this->_payload_to_send.erase(ip);
-        if (this->_broadcast_timer.find(ip) != this->_broadcast_timer.cend()){
-            this->_broadcast_timer.erase(ip);
-        }
+    while (!neighbor.pending.empty() &&
+           (neighbor.pending.size() >= this->_max_pending_datagrams ||
+            neighbor.pending_bytes + size > this->_max_pending_bytes)){
+        this->_drop_oldest(neighbor);
+        this->_stats.dropped_neighbor_full++;
     }
+
+    if (this->_stats.pending_datagrams >= this->_max_total_pending_datagrams ||
+        this->_stats.pending_bytes + size > this->_max_total_pending_bytes){
+        this->_stats.dropped_interface_full++;
+        return;
+    }
+
+    neighbor.pending.push_back(dgram);
+    neighbor.pending_bytes += size;
+    this->_stats.pending_datagrams++;
+    this->_stats.pending_bytes += size;
+}
+
+void NetworkInterface::_drop_oldest(Neighbor &neighbor){
+    const size_t size = neighbor.pending.front().header().len;
+    neighbor.pending.erase(neighbor.pending.begin());
+    neighbor.pending_bytes -= size;
+    this->_stats.pending_datagrams--;
+    this->_stats.pending_bytes -= size;
 }
@@ -2,12 +2,15 @@
 #define SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
 
 #include "ethernet_frame.hh"
+#include "neighbor_table.hh"
 #include "tcp_over_ip.hh"
 #include "tun.hh"
 
+#include <functional>
 #include <optional>
 #include <queue>
-#include <map>
+#include <utility>
+#include <vector>
 
 //! \brief A "network interface" that connects IP (the internet layer, or network layer)
 //! with Ethernet (the network access layer, or link layer).
@@ -31,13 +34,38 @@
 //! request or reply, the network interface processes the frame
 //! and learns or replies as necessary.
 class NetworkInterface {
+  public:
+    //! Largest datagram sent without fragmenting it, unless set_mtu() says otherwise
+    static constexpr size_t DEFAULT_MTU = 1500;
+
+    //! \brief Counters of the datagrams that wait for neighbors' Ethernet addresses, and of fragmentation
+    struct Stats {
+        size_t pending_datagrams{};         //!< Datagrams waiting now
+        size_t pending_bytes{};             //!< Bytes in the datagrams waiting now
+        uint64_t arp_requests_sent{};       //!< ARP requests broadcast
+        uint64_t dropped_neighbor_full{};   //!< Oldest datagrams dropped to keep a neighbor's queue within its limits
+        uint64_t dropped_interface_full{};  //!< Datagrams dropped because the interface's limits were reached
+        uint64_t dropped_unresolved{};      //!< Datagrams dropped because their neighbor never answered
+        uint64_t datagrams_fragmented{};    //!< Datagrams larger than the MTU, split up to be sent
+        uint64_t fragments_created{};       //!< Fragments they were split into
+        uint64_t dropped_too_big{};         //!< Datagrams larger than the MTU, dropped as they mustn't be split
+    };
+
+  private:
     //! Time period each mapping would be kept up to
     static const size_t _mapping_expiration_time{30000};
     
     //! Time period each mapping would be kept
     static const size_t _broadcast_resend_time{5000};
 
-  private:
+    //! Most datagrams, and bytes, that may wait for any one neighbor
+    static const size_t _max_pending_datagrams{64};
+    static const size_t _max_pending_bytes{64 * 1024};
+
+    //! Most datagrams, and bytes, that may wait for all the neighbors together
+    static const size_t _max_total_pending_datagrams{1024};
+    static const size_t _max_total_pending_bytes{1024 * 1024};
+
     //! Ethernet (known as hardware, network-access-layer, or link-layer) address of the interface
     EthernetAddress _ethernet_address;
 
@@ -47,15 +75,39 @@ class NetworkInterface {
     //! outbound queue of Ethernet frames that the NetworkInterface wants sent
     std::queue<EthernetFrame> _frames_out{};
 
-    std::map<uint32_t, EthernetAddress> _ip_to_ether{};
+    //! What's known about each neighbor: its Ethernet address, or the datagrams waiting for it
+    NeighborTable _neighbors{};
+
+    //! A time at which a neighbor's entry may go stale, and the neighbor's IP address
+    using ExpiryTimer = std::pair<size_t, uint32_t>;
+
+    //! Timers for the neighbors' entries, earliest first. Each neighbor has at most one live timer; when it
+    //! fires for an entry that has been refreshed since, it's set again for the new time. A timer left behind
+    //! by one set earlier, or by a neighbor that has gone, is ignored when it fires.
+    std::priority_queue<ExpiryTimer, std::vector<ExpiryTimer>, std::greater<ExpiryTimer>> _expiry_timers{};
+
+    //! Milliseconds elapsed, as told by tick()
+    size_t _now{0};
 
-    std::map<uint32_t, std::queue<InternetDatagram>> _payload_to_send{};
+    //! Largest datagram sent whole
+    size_t _mtu{DEFAULT_MTU};
 
-    std::map<uint32_t, size_t> _ip_mapping_timer{};
+    Stats _stats{};
 
-    std::map<uint32_t, size_t> _broadcast_timer{};
+    //! Queue a datagram for a neighbor whose Ethernet address isn't known yet, dropping what won't fit
+    void _enqueue(Neighbor &neighbor, const InternetDatagram &dgram);
 
-    void _flush();
+    //! Drop a neighbor's oldest waiting datagram
+    void _drop_oldest(Neighbor &neighbor);
+
+    //! Have the neighbor at `ip`'s timer fire by `deadline`, unless its live timer fires sooner already
+    void _schedule(Neighbor &neighbor, const uint32_t ip, const size_t deadline);
+
+    //! Send a datagram in a frame addressed to `dst`
+    void _send_ipv4(const InternetDatagram &dgram, const EthernetAddress &dst);
+
+    //! Send the datagrams waiting for the neighbor at `ip`, whose Ethernet address has just been learned
+    void _flush(const uint32_t ip);
 
   public:
     //! \brief Construct a network interface with given Ethernet (network-access-layer) and IP (internet-layer) addresses
@@ -70,6 +122,12 @@ class NetworkInterface {
     //! ("Sending" is accomplished by pushing the frame onto the frames_out queue.)
     void send_datagram(const InternetDatagram &dgram, const Address &next_hop);
 
+    //! \brief Put an Ethernet header in front of a datagram of `dgram_len` bytes whose headers are already in
+    //! `room`, for the caller to send at once, if it can go as it is: it fits the MTU, and the Ethernet address
+    //! of `next_hop` is known
+    //! \returns whether it could, leaving `room` as it was if not (the datagram then goes to send_datagram())
+    bool frame_into(Headroom &room, const size_t dgram_len, const Address &next_hop);
+
     //! \brief Receives an Ethernet frame and responds appropriately.
 
     //! If type is IPv4, returns the datagram.
@@ -79,6 +137,19 @@ class NetworkInterface {
 
     //! \brief Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
+
+    //! \brief Counters for monitoring
+    const Stats &stats() const { return _stats; }
+
+    //! \brief Number of timers kept for the neighbors' entries (live or left behind)
+    size_t expiry_timers() const { return _expiry_timers.size(); }
+
+    //! \brief Largest datagram (header included) the link carries; larger ones are fragmented, or dropped if
+    //! their DF flag is set
+    size_t mtu() const { return _mtu; }
+
+    //! \brief Change the MTU (at least 68 bytes, the least that every IPv4 link must carry)
+    void set_mtu(const size_t mtu);
 };
 
 #endif  // SPONGE_LIBSPONGE_NETWORK_INTERFACE_HH
@@ -0,0 +1,190 @@
+#include "route_table.hh"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+using namespace std;
+
+size_t RouteTable::_child(Slot &slot) {
+    if (not(slot & CHILD)) {
+        Node node;
+        node.fill(slot);
+        _nodes.push_back(node);
+        slot = CHILD | (_nodes.size() - 1);
+    }
+    return slot & ~CHILD;
+}
+
+void RouteTable::lookup_batch(const uint32_t *addresses, const RouteInfo **matches, const size_t count) const {
+    array<Slot, LOOKUP_BATCH> slots;
+    for (size_t base = 0; base < count; base += LOOKUP_BATCH) {
+        const uint32_t *const addrs = addresses + base;
+        const size_t n = min(LOOKUP_BATCH, count - base);
+
+        for (size_t i = 0; i < n; i++) {
+            __builtin_prefetch(&_root[addrs[i] >> ROOT_BITS]);
+        }
+
+        // each pass reads one level for every address, prefetching what the next pass will read
+        for (size_t i = 0; i < n; i++) {
+            slots[i] = _root[addrs[i] >> ROOT_BITS];
+            if (slots[i] & CHILD) {
+                __builtin_prefetch(&_nodes[slots[i] & ~CHILD][(addrs[i] >> NODE_BITS) & 0xff]);
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (slots[i] & CHILD) {
+                slots[i] = _nodes[slots[i] & ~CHILD][(addrs[i] >> NODE_BITS) & 0xff];
+                if (slots[i] & CHILD) {
+                    __builtin_prefetch(&_nodes[slots[i] & ~CHILD][addrs[i] & 0xff]);
+                }
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (slots[i] & CHILD) {
+                slots[i] = _nodes[slots[i] & ~CHILD][addrs[i] & 0xff];
+            }
+            matches[base + i] = slots[i] ? &_routes[slots[i] - 1] : nullptr;
+        }
+    }
+}
+
+template <typename F>
+void RouteTable::_for_each_slot(const uint32_t prefix, const uint8_t prefix_length, F &&f) {
+    const size_t root_index = prefix >> ROOT_BITS;
+    if (prefix_length <= ROOT_BITS) {
+        for (size_t i = 0; i < (size_t(1) << (ROOT_BITS - prefix_length)); i++) {
+            f(_root[root_index + i]);
+        }
+        return;
+    }
+
+    const size_t level2 = _child(_root[root_index]);
+    const size_t level2_index = (prefix >> NODE_BITS) & 0xff;
+    if (prefix_length <= ROOT_BITS + NODE_BITS) {
+        for (size_t i = 0; i < (size_t(1) << (ROOT_BITS + NODE_BITS - prefix_length)); i++) {
+            f(_nodes.mutable_at(level2)[level2_index + i]);
+        }
+        return;
+    }
+
+    const size_t level3 = _child(_nodes.mutable_at(level2)[level2_index]);
+    const size_t level3_index = prefix & 0xff;
+    for (size_t i = 0; i < (size_t(1) << (32 - prefix_length)); i++) {
+        f(_nodes.mutable_at(level3)[level3_index + i]);
+    }
+}
+
+//! \details Slots hold the longest covering route, so a shorter route only fills the slots (and the
+//! parts of lower nodes) that no longer route has claimed.
+void RouteTable::_install(Slot &slot, const Slot value, const uint8_t prefix_length) {
+    if (slot & CHILD) {
+        for (auto &lower : _nodes.mutable_at(slot & ~CHILD)) {
+            _install(lower, value, prefix_length);
+        }
+        return;
+    }
+
+    if (slot == 0 or _routes[slot - 1].prefix_length < prefix_length) {
+        slot = value;
+    }
+}
+
+void RouteTable::_reassign(Slot &slot, const Slot from, const Slot to) {
+    if (slot & CHILD) {
+        for (auto &lower : _nodes.mutable_at(slot & ~CHILD)) {
+            _reassign(lower, from, to);
+        }
+        return;
+    }
+
+    if (slot == from) {
+        slot = to;
+    }
+}
+
+uint64_t RouteTableWriter::_key(const uint32_t prefix, const uint8_t prefix_length) {
+    const uint32_t masked = prefix_length == 0 ? 0 : prefix & (0xffff'ffff << (32 - prefix_length));
+    return (uint64_t(masked) << 8) | prefix_length;
+}
+
+//! \param[in] route the route to add; bits of `route_prefix` past `prefix_length` are ignored
+bool RouteTableWriter::add(const RouteInfo &route) {
+    if (route.prefix_length > 32) {
+        throw runtime_error("RouteTableWriter::add: prefix length longer than 32 bits");
+    }
+    if (route.paths.empty()) {
+        throw runtime_error("RouteTableWriter::add: route has no paths");
+    }
+
+    const uint64_t key = _key(route.route_prefix, route.prefix_length);
+    if (_index.count(key)) {
+        return false;
+    }
+
+    RouteInfo stored = route;
+    stored.route_prefix = key >> 8;
+
+    RouteTable::Slot value;
+    if (_free_slots.empty()) {
+        _table._routes.push_back(stored);
+        value = _table._routes.size();
+    } else {
+        value = _free_slots.back();
+        _free_slots.pop_back();
+        _table._routes.mutable_at(value - 1) = stored;
+    }
+    _index.emplace(key, value);
+    _table._route_count++;
+
+    _table._for_each_slot(stored.route_prefix, stored.prefix_length, [&](RouteTable::Slot &slot) {
+        _table._install(slot, value, stored.prefix_length);
+    });
+    return true;
+}
+
+//! \param[in] route the route to add, or the new paths for the route with its prefix
+void RouteTableWriter::replace(const RouteInfo &route) {
+    const auto existing = _index.find(_key(route.route_prefix, route.prefix_length));
+    if (existing == _index.end()) {
+        add(route);
+        return;
+    }
+    if (route.paths.empty()) {
+        throw runtime_error("RouteTableWriter::replace: route has no paths");
+    }
+
+    _table._routes.mutable_at(existing->second - 1).paths = route.paths;
+}
+
+//! \details The slots the route held go to the next-longest route covering its prefix, if there is one.
+bool RouteTableWriter::remove(const uint32_t prefix, const uint8_t prefix_length) {
+    if (prefix_length > 32) {
+        return false;
+    }
+
+    const auto existing = _index.find(_key(prefix, prefix_length));
+    if (existing == _index.end()) {
+        return false;
+    }
+    const RouteTable::Slot value = existing->second;
+    _index.erase(existing);
+
+    RouteTable::Slot successor = 0;
+    for (int len = prefix_length - 1; len >= 0; len--) {
+        const auto covering = _index.find(_key(prefix, len));
+        if (covering != _index.end()) {
+            successor = covering->second;
+            break;
+        }
+    }
+
+    _table._for_each_slot(_key(prefix, prefix_length) >> 8, prefix_length, [&](RouteTable::Slot &slot) {
+        _table._reassign(slot, value, successor);
+    });
+
+    _free_slots.push_back(value);
+    _table._route_count--;
+    return true;
+}
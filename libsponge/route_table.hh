@@ -0,0 +1,170 @@
+#ifndef SPONGE_LIBSPONGE_ROUTE_TABLE_HH
+#define SPONGE_LIBSPONGE_ROUTE_TABLE_HH
+
+#include "address.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//! One way out for a route: an interface, and the next hop on it (empty if the network is directly attached)
+struct RoutePath {
+    std::optional<Address> next_hop{};
+    size_t interface_num{};
+};
+
+//! A forwarding rule: datagrams whose destination matches `route_prefix/prefix_length` go out one of `paths`
+struct RouteInfo {
+    uint32_t route_prefix{};
+    uint8_t prefix_length{};
+    std::vector<RoutePath> paths{};  //!< Equal-cost paths (at least one); each flow keeps to one of them
+
+    //! The path for the flow with hash `flow_hash`
+    const RoutePath &path(const uint64_t flow_hash) const {
+        return paths.size() == 1 ? paths.front() : paths[flow_hash % paths.size()];
+    }
+};
+
+//! \brief A vector stored in fixed-size chunks, which copies of the vector share until written
+//! \details Copying costs one reference count per chunk; writing through mutable_at() first clones the
+//! chunk if any other copy still refers to it.
+template <typename T, size_t ChunkSize>
+class ChunkedCowVector {
+    using Chunk = std::array<T, ChunkSize>;
+
+    std::vector<std::shared_ptr<Chunk>> _chunks{};
+    size_t _size{0};
+
+  public:
+    //! Read-only access to element `i`
+    const T &operator[](const size_t i) const { return (*_chunks[i / ChunkSize])[i % ChunkSize]; }
+
+    //! Writable access to element `i`, unsharing its chunk if necessary
+    T &mutable_at(const size_t i) {
+        auto &chunk = _chunks[i / ChunkSize];
+        if (chunk.use_count() > 1) {
+            chunk = std::make_shared<Chunk>(*chunk);
+        }
+        return (*chunk)[i % ChunkSize];
+    }
+
+    //! Append an element
+    void push_back(const T &value) {
+        if (_size % ChunkSize == 0) {
+            _chunks.push_back(std::make_shared<Chunk>());
+        }
+        mutable_at(_size++) = value;
+    }
+
+    //! Number of elements
+    size_t size() const { return _size; }
+};
+
+class RouteTableWriter;
+
+//! \brief A longest-prefix-match table of IPv4 routes
+//! \details The routes are expanded into a three-level multibit trie with strides of 16, 8 and 8 bits
+//! (a "DIR-16-8-8" table). Every slot holds either the index of the longest route covering it or the
+//! index of a child node, so a lookup costs at most three array reads, however many routes there are.
+//! A node is only allocated below a /16 (or /24) that has a longer route in it.
+//!
+//! A RouteTable is changed only through a RouteTableWriter. Copies share everything but the root
+//! (256 KiB), so the writer can cheaply publish each version as a snapshot that readers keep using,
+//! unchanged, for as long as they hold it.
+class RouteTable {
+  public:
+    static constexpr unsigned ROOT_BITS = 16;   //!< Address bits resolved by the root
+    static constexpr unsigned NODE_BITS = 8;    //!< Address bits resolved by each lower level
+    static constexpr size_t LOOKUP_BATCH = 32;  //!< Lookups that lookup_batch() keeps in flight at once
+
+  private:
+    friend class RouteTableWriter;
+
+    //! \brief A slot: 0 if no route covers it, `CHILD | n` to continue in node n, otherwise a route index plus 1
+    using Slot = uint32_t;
+    static constexpr Slot CHILD = 0x8000'0000;
+
+    using Node = std::array<Slot, 1 << NODE_BITS>;
+
+    ChunkedCowVector<RouteInfo, 256> _routes{};                    //!< The routes, by index
+    std::vector<Slot> _root = std::vector<Slot>(1 << ROOT_BITS);  //!< Top level, indexed by the high 16 bits
+    ChunkedCowVector<Node, 64> _nodes{};                           //!< Lower levels
+    size_t _route_count{0};                                        //!< Routes currently in the table
+
+    //! Return the node that `slot` points to, first adding one (inheriting the route `slot` held) if needed
+    size_t _child(Slot &slot);
+
+    //! Call `f` on each slot (in the root or a node) that `prefix/prefix_length` spans
+    template <typename F>
+    void _for_each_slot(const uint32_t prefix, const uint8_t prefix_length, F &&f);
+
+    //! Give `slot`, and the slots of nodes below it, to route `value` wherever it's longer than their route
+    void _install(Slot &slot, const Slot value, const uint8_t prefix_length);
+
+    //! Hand every slot held by route `from`, at or below `slot`, to route `to`
+    void _reassign(Slot &slot, const Slot from, const Slot to);
+
+  public:
+    //! \brief The longest-prefix-match route for `address`, or nullptr if no route matches
+    const RouteInfo *lookup(const uint32_t address) const {
+        Slot slot = _root[address >> ROOT_BITS];
+        if (slot & CHILD) {
+            slot = _nodes[slot & ~CHILD][(address >> NODE_BITS) & 0xff];
+            if (slot & CHILD) {
+                slot = _nodes[slot & ~CHILD][address & 0xff];
+            }
+        }
+        return slot ? &_routes[slot - 1] : nullptr;
+    }
+
+    //! \brief Look up `count` addresses at once, storing the route for `addresses[i]` (or nullptr) in `matches[i]`
+    //! \details Same results as calling lookup() on each address, but each level of the trie is fetched for
+    //! a whole batch of addresses before any of them moves on to the next, so the cache misses overlap.
+    void lookup_batch(const uint32_t *addresses, const RouteInfo **matches, const size_t count) const;
+
+    //! Number of routes in the table
+    size_t size() const { return _route_count; }
+
+    //! Number of lower-level trie nodes allocated
+    size_t node_count() const { return _nodes.size(); }
+};
+
+//! \brief Makes changes to a RouteTable and publishes them as immutable snapshots
+//! \details Not thread-safe itself: concurrent writers need to be serialized by the caller. Readers
+//! only ever see the snapshots, so they never wait for a writer.
+class RouteTableWriter {
+    RouteTable _table{};
+
+    //! Slot value (route index plus 1) of each route, keyed by prefix and length
+    std::unordered_map<uint64_t, RouteTable::Slot> _index{};
+
+    //! Indices of removed routes, for reuse
+    std::vector<RouteTable::Slot> _free_slots{};
+
+    //! The route's key in `_index`, after masking off the host bits of its prefix
+    static uint64_t _key(const uint32_t prefix, const uint8_t prefix_length);
+
+  public:
+    //! \brief Add a route
+    //! \returns false (leaving the table unchanged) if there is already a route for the same prefix
+    bool add(const RouteInfo &route);
+
+    //! \brief Add a route, or change the paths of the existing route for its prefix
+    void replace(const RouteInfo &route);
+
+    //! \brief Remove the route for `prefix/prefix_length`
+    //! \returns false if there was no such route
+    bool remove(const uint32_t prefix, const uint8_t prefix_length);
+
+    //! The table as changed so far (must not be used concurrently with further changes)
+    const RouteTable &table() const { return _table; }
+
+    //! \brief An immutable copy of the table as changed so far, for readers
+    std::shared_ptr<const RouteTable> snapshot() const { return std::make_shared<const RouteTable>(_table); }
+};
+
+#endif  // SPONGE_LIBSPONGE_ROUTE_TABLE_HH
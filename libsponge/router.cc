@@ -1,6 +1,13 @@
 #include "router.hh"
 
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
 
 using namespace std;
 
@@ -13,6 +20,14 @@ using namespace std;
 
 // You will need to add private members to the class declaration in `router.hh`
 
+size_t Router::add_interface(AsyncNetworkInterface &&interface) {
+    if (this->running()) {
+        throw runtime_error("Router: can't add an interface while the workers are running");
+    }
+    this->_interfaces.push_back(move(interface));
+    return this->_interfaces.size() - 1;
+}
+
 //! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix to match the datagram's destination address against
 //! \param[in] prefix_length For this route to be applicable, how many high-order (most-significant) bits of the route_prefix will need to match the corresponding bits of the datagram's destination address?
 //! \param[in] next_hop The IP address of the next hop. Will be empty if the network is directly attached to the router (in which case, the next hop address should be the datagram's final destination).
@@ -21,45 +36,324 @@ void Router::add_route(const uint32_t route_prefix,
                        const uint8_t prefix_length,
                        const optional<Address> next_hop,
                        const size_t interface_num) {
+    this->add_route(route_prefix, prefix_length, vector<RoutePath>{{next_hop, interface_num}});
+}
+
+//! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix of the route
+//! \param[in] prefix_length The number of high-order bits of route_prefix that are significant
+//! \param[in] paths The next hops (empty if directly attached) and interfaces to spread the traffic over
+void Router::add_route(const uint32_t route_prefix, const uint8_t prefix_length, const vector<RoutePath> &paths) {
     cerr << "DEBUG: adding route " << Address::from_ipv4_numeric(route_prefix).ip() << "/" << int(prefix_length)
-         << " => " << (next_hop.has_value() ? next_hop->ip() : "(direct)") << " on interface " << interface_num << "\n";
+         << " =>";
+    for (const auto &path : paths) {
+        cerr << " " << (path.next_hop.has_value() ? path.next_hop->ip() : "(direct)") << " on interface "
+             << path.interface_num;
+    }
+    cerr << "\n";
+
+    lock_guard<mutex> lock(this->_route_mutex);
+    this->_route_writer.add({route_prefix, prefix_length, paths});
+    this->_publish_routes();
+}
+
+//! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix of the route
+//! \param[in] prefix_length The number of high-order bits of route_prefix that are significant
+//! \param[in] next_hop The IP address of the next hop, or empty if the network is directly attached
+//! \param[in] interface_num The index of the interface to send the datagram out on.
+void Router::replace_route(const uint32_t route_prefix,
+                           const uint8_t prefix_length,
+                           const optional<Address> next_hop,
+                           const size_t interface_num) {
+    this->replace_route(route_prefix, prefix_length, vector<RoutePath>{{next_hop, interface_num}});
+}
 
-    this->_routes.push_back({route_prefix, prefix_length, next_hop, interface_num});
+//! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix of the route
+//! \param[in] prefix_length The number of high-order bits of route_prefix that are significant
+//! \param[in] paths The next hops (empty if directly attached) and interfaces to spread the traffic over
+void Router::replace_route(const uint32_t route_prefix,
+                           const uint8_t prefix_length,
+                           const vector<RoutePath> &paths) {
+    lock_guard<mutex> lock(this->_route_mutex);
+    this->_route_writer.replace({route_prefix, prefix_length, paths});
+    this->_publish_routes();
+}
+
+//! \param[in] route_prefix The "up-to-32-bit" IPv4 address prefix of the route
+//! \param[in] prefix_length The number of high-order bits of route_prefix that are significant
+bool Router::remove_route(const uint32_t route_prefix, const uint8_t prefix_length) {
+    lock_guard<mutex> lock(this->_route_mutex);
+    if (not this->_route_writer.remove(route_prefix, prefix_length)) return false;
+    this->_publish_routes();
+    return true;
+}
+
+//! \details Readers that already hold a previous snapshot keep using it: a snapshot is only freed by a
+//! later publish that finds no reader's hazard pointer on it. The new snapshot is made current before the
+//! hazard pointers are read, so a reader that announces an old one after that sees it's no longer current.
+void Router::_publish_routes() {
+    this->_snapshots.push_back(this->_route_writer.snapshot());
+    this->_routes.store(this->_snapshots.back().get(), memory_order_seq_cst);
+
+    vector<const RouteTable *> held{this->_owner_reading.table.load(memory_order_seq_cst)};
+    for (const auto &port : this->_ports) {
+        held.push_back(port->reading.table.load(memory_order_seq_cst));
+    }
+    const RouteTable *current = this->_snapshots.back().get();
+    const auto unused = [&](const shared_ptr<const RouteTable> &snapshot) {
+        return snapshot.get() != current and find(held.begin(), held.end(), snapshot.get()) == held.end();
+    };
+    this->_snapshots.erase(remove_if(this->_snapshots.begin(), this->_snapshots.end(), unused),
+                           this->_snapshots.end());
+}
+
+Router::RoutesGuard::RoutesGuard(const atomic<const RouteTable *> &current, RoutesHazard &hazard)
+    : _hazard(hazard.table), _table(current.load(memory_order_acquire)) {
+    while (true) {
+        this->_hazard.store(this->_table, memory_order_seq_cst);
+        const RouteTable *latest = current.load(memory_order_seq_cst);
+        if (latest == this->_table) break;
+        this->_table = latest;
+    }
 }
 
 //! \param[in] dgram The datagram to be routed
-void Router::route_one_datagram(InternetDatagram &dgram) {
-    auto dst = dgram.header().dst;
-    size_t curr_match = this->_routes.size();
+//! \param[in] match The route for the datagram's destination, or nullptr if there is none
+optional<Router::Hop> Router::_next_hop(InternetDatagram &dgram, const RouteInfo *match) {
+    // read-only access, so the datagram keeps trusting its parsed checksum
+    const IPv4Header &header = as_const(dgram).header();
+    auto dst = header.dst;
+
+    if (match == nullptr) return nullopt;
+    if (header.ttl <= 1) return nullopt;
 
-    for (size_t i = 0; i < this->_routes.size(); i ++){
-        auto l = 32 - this->_routes[i].prefix_length;
-        if ((dst >> l) != (this->_routes[i].route_prefix >> l) &&  l != 32) continue;
-        
-        if (curr_match == this->_routes.size()) curr_match = i;
-        if (this->_routes[i].prefix_length > this->_routes[curr_match].prefix_length) curr_match = i;
+    const RoutePath &path = match->paths.size() == 1 ? match->paths.front() : match->path(flow_hash(dgram));
+    dgram.decrement_ttl();
+
+    return Hop{path.interface_num, path.next_hop.has_value() ? path.next_hop->ipv4_numeric() : dst};
+}
+
+//! \details A [MurmurHash3](https://github.com/aappleby/smhasher) finalizer mixes the fields, so flows that
+//! differ in a single bit still spread evenly over the paths.
+uint64_t Router::flow_hash(const InternetDatagram &dgram) {
+    const IPv4Header &header = dgram.header();
+
+    // the first four bytes of both TCP and UDP headers are the source and destination ports
+    uint32_t ports = 0;
+    const bool fragment = header.mf or header.offset != 0;
+    if ((header.proto == IPv4Header::PROTO_TCP or header.proto == IPv4Header::PROTO_UDP) and not fragment) {
+        size_t have = 0;
+        for (const auto &buffer : dgram.payload().buffers()) {
+            for (size_t i = 0; i < buffer.size() and have < 4; i++, have++) {
+                ports = (ports << 8) | buffer.at(i);
+            }
+        }
+        if (have < 4) {
+            ports = 0;
+        }
     }
 
-    if (curr_match == this->_routes.size()) return;
-    Address addr = this->_routes[curr_match].next_hop.has_value() ? 
-            this->_routes[curr_match].next_hop.value() : 
-            Address::from_ipv4_numeric(dst);
+    uint64_t hash = (uint64_t(header.src) << 32) | header.dst;
+    hash ^= ((uint64_t(ports) << 8) | header.proto) * 0x9e37'79b9'7f4a'7c15;
+    hash ^= hash >> 33;
+    hash *= 0xff51'afd7'ed55'8ccd;
+    hash ^= hash >> 33;
+    hash *= 0xc4ce'b9fe'1a85'ec53;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+//! \param[in] dgram The datagram to be routed
+//! \param[in] match The route for the datagram's destination, or nullptr if there is none
+void Router::route_one_datagram(InternetDatagram &dgram, const RouteInfo *match) {
+    const optional<Hop> hop = _next_hop(dgram, match);
+    if (not hop.has_value()) return;
 
-    auto &interface = this->_interfaces[this->_routes[curr_match].interface_num];
-    
-    if (dgram.header().ttl <= 1) return;
-    dgram.header().ttl --;
-    
-    interface.send_datagram(dgram, addr);
+    this->_interfaces[hop->interface_num].send_datagram(dgram, Address::from_ipv4_numeric(hop->address));
+}
+
+//! \details Destinations are looked up a batch at a time so their cache misses overlap.
+template <typename F>
+void Router::_route_queue(queue<InternetDatagram> &queue,
+                          const RouteTable &routes,
+                          vector<InternetDatagram> &batch,
+                          F &&forward) {
+    array<uint32_t, ROUTE_BATCH> dsts;
+    array<const RouteInfo *, ROUTE_BATCH> matches;
+
+    while (not queue.empty()) {
+        batch.clear();
+        while (not queue.empty() and batch.size() < ROUTE_BATCH) {
+            batch.push_back(move(queue.front()));
+            queue.pop();
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            dsts[i] = as_const(batch[i]).header().dst;
+        }
+        routes.lookup_batch(dsts.data(), matches.data(), batch.size());
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            forward(batch[i], matches[i]);
+        }
+    }
 }
 
 void Router::route() {
+    if (this->running()) {
+        throw runtime_error("Router: route() can't be used while the workers are running");
+    }
+
+    // Hold on to one snapshot of the routes, so changes made meanwhile can't stall or disturb this pass
+    const RoutesGuard routes(this->_routes, this->_owner_reading);
+
     // Go through all the interfaces, and route every incoming datagram to its proper outgoing interface.
     for (auto &interface : _interfaces) {
-        auto &queue = interface.datagrams_out();
-        while (not queue.empty()) {
-            route_one_datagram(queue.front());
-            queue.pop();
+        _route_queue(interface.datagrams_out(),
+                     *routes,
+                     this->_batch,
+                     [this](InternetDatagram &dgram, const RouteInfo *match) { route_one_datagram(dgram, match); });
+    }
+}
+
+//! \param[in] ring_capacity How many frames or datagrams each of an interface's rings can hold
+void Router::start(const size_t ring_capacity) {
+    if (this->running()) {
+        throw runtime_error("Router: workers already running");
+    }
+
+    {
+        // the writer reads the workers' hazard pointers
+        lock_guard<mutex> lock(this->_route_mutex);
+        this->_ports.clear();
+        for (size_t i = 0; i < this->_interfaces.size(); i++) {
+            this->_ports.push_back(make_unique<Port>(ring_capacity));
         }
     }
+
+    this->_stopping.store(false);
+    for (size_t i = 0; i < this->_interfaces.size(); i++) {
+        this->_workers.emplace_back(&Router::_run_worker, this, i);
+    }
+}
+
+void Router::stop() {
+    this->_stopping.store(true);
+    for (auto &port : this->_ports) {
+        _wake(*port);
+    }
+    for (auto &worker : this->_workers) {
+        worker.join();
+    }
+    this->_workers.clear();
+}
+
+bool Router::deliver_frame(const size_t interface_num, EthernetFrame &&frame) {
+    if (not this->running()) {
+        throw runtime_error("Router: deliver_frame() needs the workers to be running");
+    }
+    Port &port = *this->_ports.at(interface_num);
+    if (port.rx.push(move(frame))) {
+        _wake(port);
+        return true;
+    }
+    this->_ring_drops++;
+    return false;
+}
+
+optional<EthernetFrame> Router::take_frame(const size_t interface_num) {
+    if (this->_ports.empty()) return nullopt;
+    return this->_ports.at(interface_num)->frames.pop();
+}
+
+//! \details Only this worker touches its interface. It receives frames from the owner, routes the datagrams
+//! in them into the transmit rings of their outbound interfaces, sends whatever the other workers have
+//! routed into its own transmit ring, and passes the resulting frames back to the owner. A frame or datagram
+//! is done with on one thread before it goes into a ring, so its Buffers never have owners on two threads
+//! at once (their reference counts aren't atomic).
+void Router::_run_worker(const size_t interface_num) {
+    AsyncNetworkInterface &interface = this->_interfaces[interface_num];
+    Port &port = *this->_ports[interface_num];
+    vector<InternetDatagram> batch;
+    auto last_tick = chrono::steady_clock::now();
+    size_t idle_spins = 0;
+
+    while (not this->_stopping.load(memory_order_acquire)) {
+        bool idle = true;
+
+        for (size_t i = 0; i < ROUTE_BATCH; i++) {
+            optional<EthernetFrame> frame = port.rx.pop();
+            if (not frame.has_value()) break;
+            interface.recv_frame(frame.value());
+            idle = false;
+        }
+
+        if (not interface.datagrams_out().empty()) {
+            const RoutesGuard routes(this->_routes, port.reading);
+            _route_queue(
+                interface.datagrams_out(), *routes, batch, [this](InternetDatagram &dgram, const RouteInfo *match) {
+                    const optional<Hop> hop = _next_hop(dgram, match);
+                    if (not hop.has_value()) return;
+                    Port &out = *this->_ports[hop->interface_num];
+                    if (out.tx.push({move(dgram), hop->address})) {
+                        _wake(out);
+                    } else {
+                        this->_ring_drops++;
+                    }
+                });
+        }
+
+        for (size_t i = 0; i < ROUTE_BATCH; i++) {
+            optional<RoutedDatagram> routed = port.tx.pop();
+            if (not routed.has_value()) break;
+            interface.send_datagram(routed->dgram, Address::from_ipv4_numeric(routed->next_hop));
+            idle = false;
+        }
+
+        auto &frames = interface.frames_out();
+        while (not frames.empty()) {
+            if (not port.frames.push(move(frames.front()))) {
+                this->_ring_drops++;
+            }
+            frames.pop();
+        }
+
+        // keep the interface's ARP timers running in real time
+        const auto now = chrono::steady_clock::now();
+        const auto elapsed = chrono::duration_cast<chrono::milliseconds>(now - last_tick);
+        if (elapsed.count() > 0) {
+            interface.tick(elapsed.count());
+            last_tick += elapsed;
+        }
+
+        // spin for a while before sleeping, so a busy router doesn't pay for waking its workers
+        if (not idle) {
+            idle_spins = 0;
+        } else if (++idle_spins < IDLE_SPINS) {
+            this_thread::yield();
+        } else {
+            this->_sleep(port);
+            idle_spins = 0;
+        }
+    }
+}
+
+//! \details The worker says it's asleep before looking at its rings one last time, and whoever fills a ring
+//! looks at whether it's asleep after doing so (with a fence between, on each side), so one of them always
+//! sees the other. A wakeup can't slip in between the last look and the wait, as the waker takes the mutex.
+void Router::_sleep(Port &port) const {
+    unique_lock<mutex> lock(port.wake_mutex);
+    port.asleep.store(true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if (port.rx.empty() and port.tx.empty() and not this->_stopping.load()) {
+        port.wake.wait_for(lock, IDLE_WAIT);
+    }
+    port.asleep.store(false, memory_order_relaxed);
+}
+
+void Router::_wake(Port &port) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (port.asleep.load(memory_order_relaxed)) {
+        lock_guard<mutex> lock(port.wake_mutex);
+        port.wake.notify_one();
+    }
 }
@@ -2,9 +2,19 @@
 #define SPONGE_LIBSPONGE_ROUTER_HH
 
 #include "network_interface.hh"
-
+#include "ring.hh"
+#include "route_table.hh"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <queue>
+#include <thread>
+#include <vector>
 
 //! \brief A wrapper for NetworkInterface that makes the host-side
 //! interface asynchronous: instead of returning received datagrams
@@ -38,34 +48,144 @@ class AsyncNetworkInterface : public NetworkInterface {
     std::queue<InternetDatagram> &datagrams_out() { return _datagrams_out; }
 };
 
-struct RouteInfo{
-    uint32_t route_prefix;
-    uint8_t prefix_length;
-    std::optional<Address> next_hop;
-    size_t interface_num;
-};
-
 //! \brief A router that has multiple network interfaces and
 //! performs longest-prefix-match routing between them.
+
+//! The router runs in one of two modes. By default, the owner delivers frames to each interface
+//! and calls route() to forward whatever the interfaces have received. After start(), each interface
+//! instead gets a worker thread of its own: the owner delivers frames with deliver_frame() and collects
+//! the frames each interface sends with take_frame(), and the workers pass routed datagrams to each
+//! other through lock-free rings.
 class Router {
+    //! Where a routed datagram goes next
+    struct Hop {
+        size_t interface_num{};  //!< The interface to send it out on
+        uint32_t address{};      //!< The IPv4 address of the next hop
+    };
+
+    //! A datagram on its way to the worker of its outbound interface
+    struct RoutedDatagram {
+        InternetDatagram dgram{};
+        uint32_t next_hop{};
+    };
+
+    //! \brief A reader's hazard pointer: the snapshot of the routes it is reading, which mustn't be freed
+    //! \details Each is on a cache line of its own, so readers don't contend for one.
+    struct alignas(64) RoutesHazard {
+        std::atomic<const RouteTable *> table{nullptr};
+    };
+
+    //! \brief A reader's hold on the current snapshot of the routes, for as long as it exists
+    //! \details Announces the snapshot in the reader's hazard pointer, then checks that it is still current;
+    //! if it isn't, tries again with the new one, so it only ever waits for a concurrent publish, never a lock.
+    class RoutesGuard {
+        std::atomic<const RouteTable *> &_hazard;
+        const RouteTable *_table;
+
+      public:
+        RoutesGuard(const std::atomic<const RouteTable *> &current, RoutesHazard &hazard);
+        ~RoutesGuard() { _hazard.store(nullptr, std::memory_order_release); }
+        RoutesGuard(const RoutesGuard &other) = delete;
+        RoutesGuard &operator=(const RoutesGuard &other) = delete;
+
+        const RouteTable &operator*() const { return *_table; }
+    };
+
+    //! The rings connecting an interface's worker to the owner and to the other workers
+    struct Port {
+        SPSCRing<EthernetFrame> rx;       //!< Frames received from the link, from deliver_frame()
+        MPSCRing<RoutedDatagram> tx;      //!< Datagrams any worker has routed out of this interface
+        SPSCRing<EthernetFrame> frames;   //!< Frames the interface has sent, for take_frame()
+        RoutesHazard reading{};           //!< The snapshot of the routes the worker is reading
+        std::mutex wake_mutex{};          //!< Held by the worker while it decides whether to sleep
+        std::condition_variable wake{};   //!< Signaled when the worker has something to do
+        std::atomic<bool> asleep{false};  //!< Whether the worker is (about to be) waiting on `wake`
+
+        explicit Port(const size_t capacity) : rx(capacity), tx(capacity), frames(capacity) {}
+    };
+
     //! The router's collection of network interfaces
     std::vector<AsyncNetworkInterface> _interfaces{};
 
-    std::vector<RouteInfo> _routes{};
+    //! In threaded mode, each interface's rings (indexed like `_interfaces`)
+    std::vector<std::unique_ptr<Port>> _ports{};
+
+    //! In threaded mode, each interface's worker
+    std::vector<std::thread> _workers{};
+
+    //! Tells the workers to finish
+    std::atomic<bool> _stopping{false};
+
+    //! Frames and datagrams dropped in threaded mode because a ring was full
+    std::atomic<uint64_t> _ring_drops{0};
+
+    //! Serializes changes to the routes
+    std::mutex _route_mutex{};
+
+    //! The routes, as changed by add_route(), replace_route() and remove_route()
+    RouteTableWriter _route_writer{};
+
+    //! Every snapshot of the routes published that a reader may still be reading, the current one last
+    //! (`_route_mutex` must be held)
+    std::vector<std::shared_ptr<const RouteTable>> _snapshots{std::make_shared<const RouteTable>()};
+
+    //! The latest snapshot of the routes; route() works from whichever snapshot is current when it starts
+    std::atomic<const RouteTable *> _routes{_snapshots.back().get()};
+
+    //! The snapshot of the routes route() is reading
+    RoutesHazard _owner_reading{};
+
+    //! Datagrams taken off an interface's queue to be routed together
+    std::vector<InternetDatagram> _batch{};
+
+    //! Most datagrams route() looks up at once
+    static constexpr size_t ROUTE_BATCH = RouteTable::LOOKUP_BATCH;
+
+    //! Publish the routes as changed so far, and free the snapshots no reader holds (`_route_mutex` must be held)
+    void _publish_routes();
+
+    //! Take the datagrams off `queue` a batch at a time, look up their routes, and pass each one
+    //! to `forward` with its route (or nullptr if there is none)
+    template <typename F>
+    static void _route_queue(std::queue<InternetDatagram> &queue,
+                             const RouteTable &routes,
+                             std::vector<InternetDatagram> &batch,
+                             F &&forward);
+
+    //! Decrement the TTL of a datagram that `match` routes, and return where it goes next (choosing
+    //! among the route's paths by the datagram's flow), or return nothing if the datagram is to be dropped
+    static std::optional<Hop> _next_hop(InternetDatagram &dgram, const RouteInfo *match);
+
+    //! Times an idle worker looks for work, yielding in between, before it sleeps
+    static constexpr size_t IDLE_SPINS = 1000;
+
+    //! Longest an idle worker sleeps, so its interface's ARP timers keep running
+    static constexpr std::chrono::milliseconds IDLE_WAIT{50};
+
+    //! Receive, route and send for one interface, until stop()
+    void _run_worker(const size_t interface_num);
+
+    //! Block the worker of `port` until it has something to do, stop() is called, or IDLE_WAIT passes
+    void _sleep(Port &port) const;
+
+    //! Wake the worker of `port` after giving it something to do, if it's asleep
+    static void _wake(Port &port);
 
     //! Send a single datagram from the appropriate outbound interface to the next hop,
-    //! as specified by the route with the longest prefix_length that matches the
-    //! datagram's destination address.
-    void route_one_datagram(InternetDatagram &dgram);
+    //! as specified by `match`, the route with the longest prefix_length that matches the
+    //! datagram's destination address (or nullptr if there is none).
+    void route_one_datagram(InternetDatagram &dgram, const RouteInfo *match);
 
   public:
-    //! Add an interface to the router
+    Router() = default;
+
+    //! Stops the workers, if running
+    ~Router() { stop(); }
+
+    //! Add an interface to the router (not in threaded mode)
     //! \param[in] interface an already-constructed network interface
     //! \returns The index of the interface after it has been added to the router
-    size_t add_interface(AsyncNetworkInterface &&interface) {
-        _interfaces.push_back(std::move(interface));
-        return _interfaces.size() - 1;
-    }
+    size_t add_interface(AsyncNetworkInterface &&interface);
 
     //! Access an interface by index
     AsyncNetworkInterface &interface(const size_t N) { return _interfaces.at(N); }
@@ -76,8 +196,56 @@ class Router {
                    const std::optional<Address> next_hop,
                    const size_t interface_num);
 
-    //! Route packets between the interfaces
+    //! Add a route whose traffic is spread, flow by flow, over several equal-cost paths
+    void add_route(const uint32_t route_prefix, const uint8_t prefix_length, const std::vector<RoutePath> &paths);
+
+    //! Add a route, or change the next hop and interface of the route with the same prefix
+    void replace_route(const uint32_t route_prefix,
+                       const uint8_t prefix_length,
+                       const std::optional<Address> next_hop,
+                       const size_t interface_num);
+
+    //! Add a route, or change the paths of the route with the same prefix
+    void replace_route(const uint32_t route_prefix,
+                       const uint8_t prefix_length,
+                       const std::vector<RoutePath> &paths);
+
+    //! Remove the route for a prefix
+    //! \returns false if there was no route for it
+    bool remove_route(const uint32_t route_prefix, const uint8_t prefix_length);
+
+    //! Route packets between the interfaces (not in threaded mode)
     void route();
+
+    //! \brief Hash of a datagram's flow, which picks its path when a route has several
+    //! \details Covers the addresses, the protocol and, for TCP and UDP, the ports. Fragments are hashed
+    //! without ports (only the first fragment has them), so all the fragments of a datagram take one path.
+    static uint64_t flow_hash(const InternetDatagram &dgram);
+
+    //! \name Threaded mode
+    //!@{
+
+    //! Start a worker thread for each interface, each with rings that hold `ring_capacity` items
+    void start(const size_t ring_capacity = 1024);
+
+    //! Stop and join the workers (frames and datagrams still in their rings are discarded)
+    void stop();
+
+    //! Whether the workers are running
+    bool running() const { return not _workers.empty(); }
+
+    //! \brief Hand a frame that interface `interface_num` received to its worker
+    //! \details Each interface's frames must be delivered from a single thread at a time.
+    //! \returns false (dropping the frame) if the interface's receive ring is full
+    bool deliver_frame(const size_t interface_num, EthernetFrame &&frame);
+
+    //! \brief Take the next frame that interface `interface_num` has sent, if there is one
+    //! \details Each interface's frames must be taken from a single thread at a time.
+    std::optional<EthernetFrame> take_frame(const size_t interface_num);
+
+    //! Frames and datagrams dropped because a ring was full
+    uint64_t ring_drops() const { return _ring_drops.load(std::memory_order_relaxed); }
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_ROUTER_HH
@@ -44,6 +44,29 @@ void StreamReassembler::push_substring(const std::string &data, const uint64_t i
     this->merge();
 }
 
+void StreamReassembler::set_capacity(const size_t capacity) {
+    this->_output.set_capacity(capacity);
+    this->_capacity = this->_output.capacity();
+
+    // drop what now lies past the end of the window
+    const uint64_t _first_unacceptable =
+        this->_first_unassembled + (this->_capacity - this->stream_out().buffer_size());
+    for (auto p = this->_pending.begin(); p != this->_pending.end();){
+        if (p->first >= _first_unacceptable){
+            this->_unassembled -= p->second.size();
+            p = this->_pending.erase(p);
+            this->_eof = false;
+            continue;
+        }
+        if (p->first + p->second.size() > _first_unacceptable){
+            this->_unassembled -= p->first + p->second.size() - _first_unacceptable;
+            p->second.resize(_first_unacceptable - p->first);
+            this->_eof = false;
+        }
+        p ++;
+    }
+}
+
 void StreamReassembler::trim(uint64_t &start, uint64_t &end) {
     if (start == end) return;
 
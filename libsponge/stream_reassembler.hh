@@ -17,7 +17,7 @@ class StreamReassembler {
     // Your code here -- add private members as necessary.
 
     ByteStream _output;  //!< The reassembled in-order byte stream
-    const size_t _capacity;    //!< The maximum number of bytes
+    size_t _capacity;    //!< The maximum number of bytes
     map<uint64_t, string> _pending; //!< Received bytes but not continuous.
 
     uint64_t _unassembled;
@@ -49,6 +49,10 @@ class StreamReassembler {
     //! \param eof the last byte of `data` will be the last byte in the entire stream
     void push_substring(const std::string &data, const uint64_t index, const bool eof);
 
+    //! \brief Change the number of bytes the reassembler (and its output stream) may hold
+    //! \note Substrings waiting to be assembled that no longer fit are discarded.
+    void set_capacity(const size_t capacity);
+
     //! \name Access the reassembled byte stream
     //!@{
     const ByteStream &stream_out() const { return _output; }
@@ -1,7 +1,11 @@
 #include "tcp_connection.hh"
 #include "tcp_state.hh"
+#include "ipv4_header.hh"
+#include "tcp_header.hh"
 
+#include <algorithm>
 #include <iostream>
+#include <utility>
 
 // For Lab 4, please replace with a real implementation that passes the
 // automated checks run by `make check`.
@@ -27,6 +31,15 @@ size_t TCPConnection::time_since_last_segment_received() const {
 void TCPConnection::segment_received(const TCPSegment &seg) {
     bool need_send_ack = seg.length_in_sequence_space();
     this->_time_since_last_segment_received = 0;
+    this->_keepalive_probes = 0;
+    const optional<WrappingInt32> ackno_before = this->_receiver.ackno();
+
+    // a keepalive probe (one before the next sequence number) is answered with an ACK, to show we're here
+    if (ackno_before.has_value() && seg.length_in_sequence_space() == 0 &&
+        seg.header().seqno == ackno_before.value() - 1){
+        need_send_ack = true;
+    }
+    const size_t unassembled_before = this->_receiver.unassembled_bytes();
     this->_receiver.segment_received(seg); 
     
     if (seg.header().rst){
@@ -60,11 +73,35 @@ void TCPConnection::segment_received(const TCPSegment &seg) {
     }
 
     if(need_send_ack){
-        if (this->_sender.segments_out().size() == 0){
-            this->_sender.send_empty_segment();
+        if (this->_ack_now(seg, ackno_before, unassembled_before)){
+            if (this->_sender.segments_out().size() == 0){
+                this->_sender.send_empty_segment();
+            }
+        }else{
+            // hold the ACK back: a segment sent meanwhile carries it, or else tick() sends it
+            this->_delayed_acks++;
         }
         this->_flush_segs();
+    }else if (seg.header().ack && this->_sender.stream_in().buffer_size() > 0){
+        // the ACK may release data held back by Nagle's algorithm, or open the window for more
+        this->_flush_segs();
+    }
+}
+
+//! \details In-order data may wait for a second segment, or for `ack_delay` milliseconds, so one ACK
+//! covers both. Anything that the peer's sender is waiting on is acknowledged at once: a SYN or FIN,
+//! a pushed segment, and a segment out of order or filling a gap (which the peer needs duplicate ACKs for).
+bool TCPConnection::_ack_now(const TCPSegment &seg, const optional<WrappingInt32> &ackno_before,
+                             const size_t unassembled_before) const {
+    // no delaying at all, or this is the second segment held back
+    if (this->_cfg.ack_delay == 0 || this->_delayed_acks > 0){
+        return true;
+    }
+    if (seg.header().syn || seg.header().fin || seg.header().psh){
+        return true;
     }
+    return !ackno_before.has_value() || seg.header().seqno != ackno_before.value() ||
+           unassembled_before > 0 || this->_receiver.unassembled_bytes() > 0;
 }
 
 bool TCPConnection::active() const {
@@ -79,6 +116,7 @@ size_t TCPConnection::write(const string &data) {
 
 //! \param[in] ms_since_last_tick number of milliseconds since the last call to this method
 void TCPConnection::tick(const size_t ms_since_last_tick) {
+    this->_clock += uint64_t(ms_since_last_tick) * 1000;
     this->_sender.tick(ms_since_last_tick);
     unsigned int retrans_count = this->_sender.consecutive_retransmissions();
     if (retrans_count > this->_cfg.MAX_RETX_ATTEMPTS){
@@ -87,8 +125,25 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
         return;
     }
     
+    // a delayed ACK whose time is up
+    if (this->_delayed_acks > 0){
+        this->_ack_timer += ms_since_last_tick;
+        if (this->_ack_timer >= this->_cfg.ack_delay && this->_sender.segments_out().size() == 0){
+            this->_sender.send_empty_segment();
+        }
+    }
+
+    this->_tune_receive_buffer();
+
+    // the reader has made enough room to be worth telling the peer about
+    if (this->_receiver.window_update_due() && this->_sender.segments_out().size() == 0){
+        this->_sender.send_empty_segment();
+    }
+
     this->_flush_segs();
     this->_time_since_last_segment_received += ms_since_last_tick;
+    this->_keepalive();
+    if (!this->_is_active) return;
 
     if (TCPState::state_summary(this->_sender) == TCPSenderStateSummary::FIN_ACKED &&
         TCPState::state_summary(this->_receiver) == TCPReceiverStateSummary::FIN_RECV &&
@@ -100,11 +155,131 @@ void TCPConnection::tick(const size_t ms_since_last_tick) {
     }
 }
 
+//! \details As in Linux: the receiver times how long a window's worth of data takes to arrive (an upper
+//! bound on the RTT, with no timestamps to go by), and every RTT it looks at how much the reader drained.
+//! When that approaches the buffer, the reader keeps up and the window is what holds the sender back, so
+//! the buffer grows to twice that, leaving the window room to open for the sender's growth too.
+void TCPConnection::_tune_receive_buffer() {
+    if (this->_memory_pressure || this->_receiver.capacity() >= this->_cfg.recv_capacity_max ||
+        !this->_receiver.ackno().has_value()) return;
+
+    const ByteStream &inbound = this->_receiver.stream_out();
+    if (!this->_rtt_probe.has_value()){
+        this->_rtt_probe = make_pair(inbound.bytes_written() + this->_receiver.window_size(), this->_clock);
+    }else if (inbound.bytes_written() >= this->_rtt_probe->first){
+        const uint64_t sample = this->_clock - this->_rtt_probe->second;
+        // a sample is only ever too high (the sender may not have had a window's worth to send), so low ones win
+        if (sample > 0 && (this->_rcv_rtt == 0 || sample < this->_rcv_rtt)){
+            this->_rcv_rtt = sample;
+        }else if (sample > 0){
+            this->_rcv_rtt = (7 * this->_rcv_rtt + sample) / 8;
+        }
+        this->_rtt_probe.reset();
+    }
+
+    if (this->_rcv_rtt == 0 || this->_clock - this->_tune_start < this->_rcv_rtt) return;
+
+    const uint64_t drained = inbound.bytes_read() - this->_tune_read;
+    this->_tune_start = this->_clock;
+    this->_tune_read = inbound.bytes_read();
+    if (2 * drained > this->_receiver.capacity()){
+        this->_receiver.set_capacity(min<uint64_t>(2 * drained, this->_cfg.recv_capacity_max));
+    }
+}
+
+bool TCPConnection::_keepalive_applies() const {
+    const TCPState state = this->state();
+    return (state == TCPState::State::ESTABLISHED || state == TCPState::State::CLOSE_WAIT) &&
+           this->_sender.bytes_in_flight() == 0 && this->_sender.stream_in().buffer_empty();
+}
+
+//! \details As in RFC 1122 and Linux: once nothing has been received for `keepalive_idle` ms, and there's no
+//! data in flight (whose retransmissions would find a dead peer anyway), a probe goes out every
+//! `keepalive_intvl` ms. A probe carries the sequence number before the next one, which the peer has
+//! already acknowledged, so it has to answer with an ACK. Anything received resets the count; after
+//! `keepalive_probes` probes have gone unanswered, the peer is given up on and the connection reset.
+void TCPConnection::_keepalive() {
+    if (this->_cfg.keepalive_idle == 0 || !this->_keepalive_applies()) return;
+
+    const uint64_t due = this->_cfg.keepalive_idle + uint64_t(this->_keepalive_probes) * this->_cfg.keepalive_intvl;
+    if (this->_time_since_last_segment_received < due) return;
+
+    if (this->_keepalive_probes >= this->_cfg.keepalive_probes){
+        this->_send_reset();
+        this->_reset_connection();
+        return;
+    }
+
+    TCPSegment probe;
+    probe.header().seqno = this->_sender.next_seqno() - 1;
+    this->_enrich_seg(probe);
+    this->_segments_out.push(move(probe));
+    this->_keepalive_probes++;
+}
+
+bool TCPConnection::idle() const {
+    return this->_is_active && this->_keepalive_applies() && this->_delayed_acks == 0 &&
+           this->_segments_out.empty() && !this->_receiver.window_update_due();
+}
+
+optional<size_t> TCPConnection::keepalive_due() const {
+    if (this->_cfg.keepalive_idle == 0 || !this->idle()) return {};
+
+    const uint64_t due = this->_cfg.keepalive_idle + uint64_t(this->_keepalive_probes) * this->_cfg.keepalive_intvl;
+    if (due <= this->_time_since_last_segment_received) return 0;
+    return due - this->_time_since_last_segment_received;
+}
+
+void TCPConnection::set_memory_pressure(const bool pressure) {
+    this->_memory_pressure = pressure;
+    if (pressure){
+        this->_receiver.set_capacity(this->_cfg.recv_capacity);
+    }
+
+    // start measuring afresh
+    this->_rtt_probe.reset();
+    this->_tune_start = this->_clock;
+    this->_tune_read = this->_receiver.stream_out().bytes_read();
+}
+
+void TCPConnection::set_pacing_rate(const uint64_t rate) {
+    this->_pacing_rate = rate;
+}
+
+//! \details Earliest departure time (EDT) pacing: each segment may leave once the one before it has had
+//! its share of the rate, counting its IPv4 and TCP headers. A connection that has been idle gets no credit
+//! for it, so the next segment leaves now rather than in a burst to catch up.
+void TCPConnection::_pace(TCPSegment &seg) {
+    if (this->_pacing_rate == 0) return;
+
+    const uint64_t departure = max(this->_clock, this->_next_departure);
+    const uint64_t size = seg.payload().size() + IPv4Header::LENGTH + TCPHeader::LENGTH;
+    seg.set_departure(departure);
+    this->_next_departure = departure + size * 1000000 / this->_pacing_rate;
+}
+
+//! \param[in] mtu the largest IPv4 datagram, headers included, that the path carries
+void TCPConnection::path_mtu_reported(const size_t mtu) {
+    if (mtu <= IPv4Header::LENGTH + TCPHeader::LENGTH) return;
+
+    this->_sender.max_payload_reported(mtu - IPv4Header::LENGTH - TCPHeader::LENGTH);
+    this->_flush_segs();
+}
+
 void TCPConnection::end_input_stream() {
     this->_sender.stream_in().end_input();
     this->_flush_segs();    
 }
 
+void TCPConnection::cork() {
+    this->_sender.cork(this->_cfg.cork_timeout);
+}
+
+void TCPConnection::uncork() {
+    this->_sender.uncork();
+    this->_flush_segs();
+}
+
 void TCPConnection::connect() {
     this->_sender.fill_window();
     _is_active = true;
@@ -116,7 +291,7 @@ void TCPConnection::_send_reset() {
     seg.header().rst = true;
     this->_enrich_seg(seg);
 
-    this->_segments_out.push(seg);
+    this->_segments_out.push(move(seg));
 }
 
 void TCPConnection::_flush_segs() {
@@ -128,11 +303,15 @@ void TCPConnection::_flush_segs() {
     this->_sender.fill_window();
 
     while (this->_sender.segments_out().size() > 0){
-        TCPSegment seg = this->_sender.segments_out().front();
+        this->_segments_out.push(move(this->_sender.segments_out().front()));
         this->_sender.segments_out().pop();
 
-        this->_enrich_seg(seg);
-        this->_segments_out.push(seg);
+        this->_enrich_seg(this->_segments_out.back());
+        this->_pace(this->_segments_out.back());
+
+        // whatever goes out carries the latest ACK
+        this->_delayed_acks = 0;
+        this->_ack_timer = 0;
     }
 }
 
@@ -143,14 +322,14 @@ void TCPConnection::_reset_connection(){
     this->_is_active = false;
 }
 
-void TCPConnection::_enrich_seg(TCPSegment& seg) const {
+void TCPConnection::_enrich_seg(TCPSegment& seg) {
     auto ackno = this->_receiver.ackno();
     if (ackno.has_value()){
         seg.header().ack = true;
         seg.header().ackno = ackno.value();
     }
 
-    seg.header().win = this->_receiver.window_size();
+    seg.header().win = this->_receiver.advertise_window();
 }
 
 TCPConnection::~TCPConnection() {
@@ -6,12 +6,15 @@
 #include "tcp_sender.hh"
 #include "tcp_state.hh"
 
+#include <optional>
+#include <utility>
+
 //! \brief A complete endpoint of a TCP connection
 class TCPConnection {
   private:
     TCPConfig _cfg;
     TCPReceiver _receiver{_cfg.recv_capacity};
-    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn};
+    TCPSender _sender{_cfg.send_capacity, _cfg.rt_timeout, _cfg.fixed_isn, _cfg.mss, _cfg.mss_probe_limit};
 
     //! outbound queue of segments that the TCPConnection wants sent
     std::queue<TCPSegment> _segments_out{};
@@ -25,8 +28,55 @@ class TCPConnection {
 
     bool _is_active{true};
 
+    //! segments received whose ACK is being held back (delayed ACK, RFC 1122 and RFC 5681)
+    unsigned _delayed_acks{0};
+
+    //! milliseconds since the oldest ACK being held back was due
+    size_t _ack_timer{0};
+
+    //! microseconds elapsed, as told by tick(): the clock that departure times are on
+    uint64_t _clock{0};
+
+    //! bytes per second that segments are paced out at (0 for no pacing)
+    uint64_t _pacing_rate{_cfg.pacing_rate};
+
+    //! earliest departure time for the next segment, once the one before it has had its share of the rate
+    uint64_t _next_departure{0};
+
+    //! give `seg` its earliest departure time, when pacing
+    void _pace(TCPSegment &seg);
+
+    //! receive-side RTT estimate, in microseconds (0 until measured)
+    uint64_t _rcv_rtt{0};
+
+    //! the RTT measurement under way, if any: the stream index whose arrival ends it, and when it started
+    std::optional<std::pair<uint64_t, uint64_t>> _rtt_probe{};
+
+    //! start of the current auto-tuning round, and the bytes the reader had read by then
+    uint64_t _tune_start{0};
+    uint64_t _tune_read{0};
+
+    //! is the owner short of memory (see set_memory_pressure())?
+    bool _memory_pressure{false};
+
+    //! grow the receive buffer to fit the bytes the reader drains per RTT (dynamic right-sizing)
+    void _tune_receive_buffer();
+
+    //! keepalive probes sent since the last segment was received
+    unsigned _keepalive_probes{0};
+
+    //! is the connection established with nothing to send or in flight, so that keepalive applies?
+    bool _keepalive_applies() const;
+
+    //! probe a peer that has been quiet too long, and reset the connection once it has given up on it
+    void _keepalive();
+
+    //! must `seg` be acknowledged right away, rather than in a delayed ACK?
+    bool _ack_now(const TCPSegment &seg, const std::optional<WrappingInt32> &ackno_before,
+                  const size_t unassembled_before) const;
+
     void _send_reset();
-    void _enrich_seg(TCPSegment& seg) const;
+    void _enrich_seg(TCPSegment& seg);
     void _flush_segs();
     void _reset_connection();
 
@@ -46,6 +96,13 @@ class TCPConnection {
 
     //! \brief Shut down the outbound byte stream (still allows reading incoming data)
     void end_input_stream();
+
+    //! \brief Hold back data short of a full segment, so that the writes that follow fill it
+    //! \details Like TCP_CORK: held data goes out once uncork() is called, or after `cork_timeout` ms.
+    void cork();
+
+    //! \brief Send what cork() held back, and stop holding data back
+    void uncork();
     //!@}
 
     //! \name "Output" interface for the reader
@@ -64,6 +121,16 @@ class TCPConnection {
     size_t unassembled_bytes() const;
     //! \brief Number of milliseconds since the last segment was received
     size_t time_since_last_segment_received() const;
+    //! \brief Largest payload the connection puts in a segment (its effective MSS), as path MTU discovery finds it
+    size_t mss() const { return _sender.max_payload_size(); }
+    //! \brief Microseconds elapsed, as told by tick(); the clock that TCPSegment::departure() is on
+    uint64_t clock() const { return _clock; }
+    //! \brief Bytes the receive buffer holds at most, as auto-tuning sizes it
+    size_t receive_capacity() const { return _receiver.capacity(); }
+    //! \brief Bytes per second that segments are paced out at (0 for no pacing)
+    uint64_t pacing_rate() const { return _pacing_rate; }
+    //! \brief Keepalive probes sent since the last segment was received
+    unsigned keepalive_probes() const { return _keepalive_probes; }
     //!< \brief summarize the state of the sender, receiver, and the connection
     TCPState state() const { return {_sender, _receiver, active(), _linger_after_streams_finish}; };
     //!@}
@@ -77,6 +144,26 @@ class TCPConnection {
     //! Called periodically when time elapses
     void tick(const size_t ms_since_last_tick);
 
+    //! \brief Has the connection nothing to do until a segment arrives, the owner acts, or keepalive_due()?
+    //! \details An idle connection needn't be ticked in the meantime: a single tick() with all the time that
+    //! has passed catches it up.
+    bool idle() const;
+
+    //! \brief Milliseconds until the next keepalive probe (or reset) is due, if the connection is idle and
+    //! keepalive is on
+    std::optional<size_t> keepalive_due() const;
+
+    //! \brief Called when the owner becomes short of memory, and again when it no longer is
+    //! \details Under pressure, the receive buffer goes back to `recv_capacity` and auto-tuning stops growing
+    //! it. The window already advertised is kept, so the buffer shrinks as the reader drains it.
+    void set_memory_pressure(const bool pressure);
+
+    //! Set the rate to pace segments out at, in bytes per second (0 for no pacing), e.g. from congestion control
+    void set_pacing_rate(const uint64_t rate);
+
+    //! Called when the network reports the path's MTU (in an ICMP "fragmentation needed" message)
+    void path_mtu_reported(const size_t mtu);
+
     //! \brief TCPSegments that the TCPConnection has enqueued for transmission.
     //! \note The owner or operating system will dequeue these and
     //! put each one into the payload of a lower-layer datagram (usually Internet datagrams (IP),
@@ -90,7 +177,11 @@ class TCPConnection {
     //!@}
 
     //! Construct a new connection from a configuration
-    explicit TCPConnection(const TCPConfig &cfg) : _cfg{cfg} {}
+    explicit TCPConnection(const TCPConfig &cfg) : _cfg{cfg} {
+        _sender.set_nagle(_cfg.nagle);
+        _sender.set_sws_avoidance(_cfg.sws_avoidance);
+        _receiver.set_sws_avoidance(_cfg.sws_avoidance ? _cfg.mss : 0);
+    }
 
     //! \name construction and destruction
     //! moving is allowed; copying is disallowed; default construction not possible
@@ -22,3 +22,8 @@ BufferList EthernetFrame::serialize() const {
     ret.append(_payload);
     return ret;
 }
+
+//! \param[in,out] room is where the header is prepended; the caller sends `payload()` right after it
+void EthernetFrame::serialize_into(Headroom &room) const {
+    _header.serialize_into(room.prepend(EthernetHeader::LENGTH), EthernetHeader::LENGTH);
+}
@@ -17,6 +17,9 @@ class EthernetFrame {
     //! \brief Serialize the frame to a string
     BufferList serialize() const;
 
+    //! \brief Serialize the header into `room`, in front of anything already there; the payload isn't copied
+    void serialize_into(Headroom &room) const;
+
     //! \name Accessors
     //!@{
     const EthernetHeader &header() const { return _header; }
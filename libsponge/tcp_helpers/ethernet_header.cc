@@ -2,50 +2,54 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <iomanip>
 #include <sstream>
 
 using namespace std;
 
 ParseResult EthernetHeader::parse(NetParser &p) {
-    if (p.buffer().size() < EthernetHeader::LENGTH) {
+    const uint8_t *const raw = p.peek(EthernetHeader::LENGTH);
+    if (not raw) {
         return ParseResult::PacketTooShort;
     }
 
     /* read destination address */
-    for (auto &byte : dst) {
-        byte = p.u8();
-    }
+    copy(raw, raw + dst.size(), dst.begin());
 
     /* read source address */
-    for (auto &byte : src) {
-        byte = p.u8();
-    }
+    copy(raw + dst.size(), raw + dst.size() + src.size(), src.begin());
 
     /* read the frame's type (e.g. IPv4, ARP, or something else) */
-    type = p.u16();
+    type = NetParser::load_u16(raw + 12);
 
+    p.remove_prefix(EthernetHeader::LENGTH);
     return p.get_error();
 }
 
 string EthernetHeader::serialize() const {
-    string ret;
-    ret.reserve(LENGTH);
+    string ret(LENGTH, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()), ret.size());
+    return ret;
+}
+
+void EthernetHeader::serialize_into(uint8_t *out, const size_t capacity) const {
+    if (capacity < LENGTH) {
+        throw runtime_error("EthernetHeader::serialize_into: not enough room");
+    }
 
     /* write destination address */
     for (auto &byte : dst) {
-        NetUnparser::u8(ret, byte);
+        NetUnparser::u8(out, byte);
     }
 
     /* write source address */
     for (auto &byte : src) {
-        NetUnparser::u8(ret, byte);
+        NetUnparser::u8(out, byte);
     }
 
     /* write the frame's type (e.g. IPv4, ARP or something else) */
-    NetUnparser::u16(ret, type);
-
-    return ret;
+    NetUnparser::u16(out, type);
 }
 
 //! \returns A string with a textual representation of an Ethernet address
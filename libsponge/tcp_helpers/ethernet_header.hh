@@ -33,6 +33,9 @@ struct EthernetHeader {
     //! Serialize the Ethernet fields to a string
     std::string serialize() const;
 
+    //! Serialize the Ethernet fields into `capacity` bytes of preallocated memory at `out`
+    void serialize_into(uint8_t *out, const size_t capacity) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 };
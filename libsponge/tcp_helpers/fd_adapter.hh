@@ -8,6 +8,7 @@
 #include "tcp_header.hh"
 #include "tcp_segment.hh"
 
+#include <algorithm>
 #include <optional>
 #include <utility>
 
@@ -15,12 +16,16 @@
 //! \details See TCPOverUDPSocketAdapter and TCPOverIPv4OverTunFdAdapter for more information.
 class FdAdapterBase {
   private:
-    FdAdapterConfig _cfg{};  //!< Configuration values
-    bool _listen = false;    //!< Is the connected TCP FSM in listen state?
+    FdAdapterConfig _cfg{};                    //!< Configuration values
+    bool _listen = false;                      //!< Is the connected TCP FSM in listen state?
+    std::optional<size_t> _path_mtu_report{};  //!< Path MTU reported by the network, not yet taken
 
   protected:
     FdAdapterConfig &config_mutable() { return _cfg; }
 
+    //! Record a path MTU reported by the network, for the TCP connection to take
+    void report_path_mtu(const size_t mtu) { _path_mtu_report = std::min(mtu, _path_mtu_report.value_or(mtu)); }
+
   public:
     //! \brief Set the listening flag
     //! \param[in] l is the new value for the flag
@@ -40,6 +45,9 @@ class FdAdapterBase {
 
     //! Called periodically when time elapses
     void tick(const size_t) {}
+
+    //! \brief Take the path MTU reported by the network since the last call, if any
+    std::optional<size_t> take_path_mtu_report() { return std::exchange(_path_mtu_report, std::nullopt); }
 };
 
 //! \brief A FD adaptor that reads and writes TCP segments in UDP payloads
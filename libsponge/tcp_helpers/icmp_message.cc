@@ -0,0 +1,43 @@
+#include "icmp_message.hh"
+
+#include "util.hh"
+
+using namespace std;
+
+ParseResult ICMPMessage::parse(const Buffer buffer) {
+    NetParser p{buffer};
+
+    if (p.buffer().size() < HEADER_LENGTH) {
+        return ParseResult::PacketTooShort;
+    }
+
+    InternetChecksum check;
+    check.add(buffer.str());
+    if (check.value() != 0) {
+        return ParseResult::BadChecksum;
+    }
+
+    type = p.u8();
+    code = p.u8();
+    p.u16();  // checksum
+    rest_of_header = p.u32();
+    original = p.buffer().copy();
+
+    return p.get_error();
+}
+
+string ICMPMessage::serialize() const {
+    string ret;
+    NetUnparser::u8(ret, type);
+    NetUnparser::u8(ret, code);
+    NetUnparser::u16(ret, 0);
+    NetUnparser::u32(ret, rest_of_header);
+    ret.append(original);
+
+    InternetChecksum check;
+    check.add(ret);
+    const uint16_t cksum = check.value();
+    ret[2] = char(cksum >> 8);
+    ret[3] = char(cksum & 0xff);
+    return ret;
+}
@@ -0,0 +1,35 @@
+#ifndef SPONGE_LIBSPONGE_ICMP_MESSAGE_HH
+#define SPONGE_LIBSPONGE_ICMP_MESSAGE_HH
+
+#include "buffer.hh"
+#include "parser.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+//! \brief ICMP (RFC 792) error message, as carried in an IPv4 datagram
+struct ICMPMessage {
+    static constexpr size_t HEADER_LENGTH = 8;                  //!< ICMP header length in bytes
+    static constexpr uint8_t TYPE_DESTINATION_UNREACHABLE = 3;  //!< The datagram couldn't be delivered
+    static constexpr uint8_t CODE_FRAGMENTATION_NEEDED = 4;     //!< Too big to forward, and DF was set (RFC 1191)
+
+    //! \name ICMP fields
+    //!@{
+    uint8_t type{};
+    uint8_t code{};
+    uint32_t rest_of_header{};  //!< Meaning depends on the type; for "fragmentation needed", the next-hop MTU
+    std::string original{};     //!< Header and first 8 payload bytes of the datagram that caused the error
+    //!@}
+
+    //! The MTU of the link the datagram couldn't be forwarded over (0 if the router didn't say)
+    uint16_t next_hop_mtu() const { return rest_of_header & 0xffff; }
+
+    //! Parse the ICMP message from a string, checking its checksum
+    ParseResult parse(const Buffer buffer);
+
+    //! Serialize the ICMP message to a string, computing its checksum
+    std::string serialize() const;
+};
+
+#endif  // SPONGE_LIBSPONGE_ICMP_MESSAGE_HH
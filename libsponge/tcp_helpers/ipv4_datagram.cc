@@ -3,14 +3,17 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <stdexcept>
 #include <string>
+#include <utility>
+#include <vector>
 
 using namespace std;
 
 ParseResult IPv4Datagram::parse(const Buffer buffer) {
     NetParser p{buffer};
-    _header.parse(p);
+    _cksum_valid = _header.parse(p) == ParseResult::NoError;
     _payload = p.buffer();
 
     if (_payload.size() != _header.payload_length()) {
@@ -25,17 +28,78 @@ BufferList IPv4Datagram::serialize() const {
         throw runtime_error("IPv4Datagram::serialize: payload is wrong size");
     }
 
-    IPv4Header header_out = _header;
-    header_out.cksum = 0;
-    const string header_zero_checksum = header_out.serialize();
-
-    // calculate checksum -- taken over header only
-    InternetChecksum check;
-    check.add(header_zero_checksum);
-    header_out.cksum = check.value();
+    string header(4 * _header.hlen, 0);
+    _serialize_header(reinterpret_cast<uint8_t *>(header.data()), header.size());
 
     BufferList ret;
-    ret.append(header_out.serialize());
+    ret.append(move(header));
     ret.append(_payload);
     return ret;
 }
+
+//! \param[in,out] room is where the header is prepended; the caller sends `payload()` right after it
+void IPv4Datagram::serialize_into(Headroom &room) const {
+    const size_t header_len = 4 * _header.hlen;
+    _serialize_header(room.prepend(header_len), header_len);
+}
+
+void IPv4Datagram::_serialize_header(uint8_t *out, const size_t capacity) const {
+    // a parsed (and possibly forwarded) header already carries a correct checksum
+    if (_cksum_valid) {
+        _header.serialize_into(out, capacity);
+        return;
+    }
+
+    // calculate checksum -- taken over header only
+    IPv4Header header_out = _header;
+    header_out.compute_cksum();
+    header_out.serialize_into(out, capacity);
+}
+
+//! \details The TTL shares a 16-bit word of the header with the protocol number, so
+//! the checksum can be patched in constant time (RFC 1624) rather than recomputed.
+//! If the checksum isn't trusted (e.g. the header was built by hand), serialize()
+//! will still recompute it from scratch, so calling this is always safe.
+void IPv4Datagram::decrement_ttl() {
+    const uint16_t old_word = (_header.ttl << 8) | _header.proto;
+    _header.ttl--;
+    const uint16_t new_word = (_header.ttl << 8) | _header.proto;
+    _header.cksum = InternetChecksum::adjust16(_header.cksum, old_word, new_word);
+}
+
+//! \param[in] mtu the largest datagram (header included) that the link can carry
+//! \details Only the first fragment keeps the header's options. RFC 791 copies into the others just the options
+//! with the "copied" flag set, and IPv4Header keeps no options (it pads them out with zeros, which read as
+//! End of Option List, not a copied option), so the other fragments have none.
+std::vector<IPv4Datagram> IPv4Datagram::fragment(const size_t mtu) const {
+    const size_t header_len = 4 * _header.hlen;
+    if (mtu < header_len + 8) {
+        throw runtime_error("IPv4Datagram::fragment: MTU too small for any payload");
+    }
+
+    // the rest of the payload, sharing its buffers: each fragment copies its piece straight out of them
+    BufferList rest = _payload;
+    const size_t total = rest.size();
+
+    vector<IPv4Datagram> fragments;
+    for (size_t start = 0; start < total or fragments.empty();) {
+        IPv4Datagram piece;
+        piece._header = _header;
+        if (start > 0) {
+            piece._header.hlen = IPv4Header::LENGTH / 4;
+        }
+
+        // every fragment but the last carries a multiple of 8 bytes, as offsets count 8-byte units
+        const size_t piece_header_len = 4 * piece._header.hlen;
+        const size_t size = min((mtu - piece_header_len) & ~size_t(7), total - start);
+
+        piece._header.len = piece_header_len + size;
+        piece._header.offset = _header.offset + start / 8;
+        piece._header.mf = start + size < total or _header.mf;
+        piece._payload = Buffer(rest, size);
+        rest.remove_prefix(size);
+        fragments.push_back(move(piece));
+        start += size;
+    }
+    return fragments;
+}
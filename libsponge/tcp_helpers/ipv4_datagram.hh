@@ -4,12 +4,20 @@
 #include "buffer.hh"
 #include "ipv4_header.hh"
 
+#include <vector>
+
 //! \brief [IPv4](\ref rfc::rfc791) Internet datagram
 class IPv4Datagram {
   private:
     IPv4Header _header{};
     BufferList _payload{};
 
+    //! Does `_header.cksum` match the rest of the header? (lets serialize() skip recomputing it)
+    bool _cksum_valid{false};
+
+    //! Write the header, with a correct checksum, into `4 * hlen` bytes at `out`
+    void _serialize_header(uint8_t *out, const size_t capacity) const;
+
   public:
     //! \brief Parse the segment from a string
     ParseResult parse(const Buffer buffer);
@@ -17,14 +25,32 @@ class IPv4Datagram {
     //! \brief Serialize the segment to a string
     BufferList serialize() const;
 
+    //! \brief Serialize the header into `room`, in front of anything already there; the payload isn't copied
+    void serialize_into(Headroom &room) const;
+
     //! \name Accessors
     //!@{
     const IPv4Header &header() const { return _header; }
-    IPv4Header &header() { return _header; }
+    //! \note Mutable access may change any field, so the checksum is recomputed by the next serialize()
+    IPv4Header &header() {
+        _cksum_valid = false;
+        return _header;
+    }
 
     const BufferList &payload() const { return _payload; }
     BufferList &payload() { return _payload; }
     //!@}
+
+    //! \brief Decrement the TTL, patching the header checksum incrementally instead of recomputing it
+    void decrement_ttl();
+
+    //! Is this datagram a fragment of a larger one?
+    bool is_fragment() const { return _header.mf or _header.offset != 0; }
+
+    //! \brief Split the datagram into fragments of at most `mtu` bytes each (ignoring the DF flag)
+    //! \details The fragments carry the datagram's header (and so its identification number), each with its
+    //! own length, offset and MF flag. A fragment of a datagram can itself be split further.
+    std::vector<IPv4Datagram> fragment(const size_t mtu) const;
 };
 
 using InternetDatagram = IPv4Datagram;
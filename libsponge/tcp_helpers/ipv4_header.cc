@@ -2,7 +2,9 @@
 
 #include "util.hh"
 
+#include <algorithm>
 #include <arpa/inet.h>
+#include <array>
 #include <iomanip>
 #include <sstream>
 
@@ -24,27 +26,30 @@ ParseResult IPv4Header::parse(NetParser &p) {
     Buffer original_serialized_version = p.buffer();
 
     const size_t data_size = p.buffer().size();
-    if (data_size < IPv4Header::LENGTH) {
+
+    // one bounds check covers all the fixed fields
+    const uint8_t *const raw = p.peek(IPv4Header::LENGTH);
+    if (not raw) {
         return ParseResult::PacketTooShort;
     }
 
-    const uint8_t first_byte = p.u8();
-    ver = first_byte >> 4;     // version
-    hlen = first_byte & 0x0f;  // header length
-    tos = p.u8();              // type of service
-    len = p.u16();             // length
-    id = p.u16();              // id
+    ver = raw[0] >> 4;                      // version
+    hlen = raw[0] & 0x0f;                   // header length
+    tos = raw[1];                           // type of service
+    len = NetParser::load_u16(raw + 2);     // length
+    id = NetParser::load_u16(raw + 4);      // id
 
-    const uint16_t fo_val = p.u16();
+    const uint16_t fo_val = NetParser::load_u16(raw + 6);
     df = static_cast<bool>(fo_val & 0x4000);  // don't fragment
     mf = static_cast<bool>(fo_val & 0x2000);  // more fragments
     offset = fo_val & 0x1fff;                 // offset
 
-    ttl = p.u8();     // ttl
-    proto = p.u8();   // proto
-    cksum = p.u16();  // checksum
-    src = p.u32();    // source address
-    dst = p.u32();    // destination address
+    ttl = raw[8];                           // ttl
+    proto = raw[9];                         // proto
+    cksum = NetParser::load_u16(raw + 10);  // checksum
+    src = NetParser::load_u32(raw + 12);    // source address
+    dst = NetParser::load_u32(raw + 16);    // destination address
+    p.remove_prefix(IPv4Header::LENGTH);
 
     if (data_size < 4 * hlen) {
         return ParseResult::PacketTooShort;
@@ -76,6 +81,15 @@ ParseResult IPv4Header::parse(NetParser &p) {
 
 //! Serialize the IPv4Header to a string (does not recompute the checksum)
 string IPv4Header::serialize() const {
+    string ret(4 * hlen, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()), ret.size());
+    return ret;
+}
+
+//! \param[out] out is where the header is written (exactly `4 * hlen` bytes, zero-padded past the fixed fields)
+//! \param[in] capacity is the space available at `out`
+//! \note Does not recompute the checksum
+void IPv4Header::serialize_into(uint8_t *out, const size_t capacity) const {
     // sanity checks
     if (ver != 4) {
         throw runtime_error("wrong IP version");
@@ -83,30 +97,41 @@ string IPv4Header::serialize() const {
     if (4 * hlen < IPv4Header::LENGTH) {
         throw runtime_error("IP header too short");
     }
+    if (capacity < 4 * size_t(hlen)) {
+        throw runtime_error("IPv4Header::serialize_into: not enough room");
+    }
 
-    string ret;
-    ret.reserve(4 * hlen);
+    uint8_t *const end = out + 4 * hlen;
 
     const uint8_t first_byte = (ver << 4) | (hlen & 0xf);
-    NetUnparser::u8(ret, first_byte);  // version and header length
-    NetUnparser::u8(ret, tos);         // type of service
-    NetUnparser::u16(ret, len);        // length
-    NetUnparser::u16(ret, id);         // id
+    NetUnparser::u8(out, first_byte);  // version and header length
+    NetUnparser::u8(out, tos);         // type of service
+    NetUnparser::u16(out, len);        // length
+    NetUnparser::u16(out, id);         // id
 
     const uint16_t fo_val = (df ? 0x4000 : 0) | (mf ? 0x2000 : 0) | (offset & 0x1fff);
-    NetUnparser::u16(ret, fo_val);  // flags and offset
+    NetUnparser::u16(out, fo_val);  // flags and offset
 
-    NetUnparser::u8(ret, ttl);    // time to live
-    NetUnparser::u8(ret, proto);  // protocol number
+    NetUnparser::u8(out, ttl);    // time to live
+    NetUnparser::u8(out, proto);  // protocol number
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::u16(out, cksum);  // checksum
 
-    NetUnparser::u32(ret, src);  // src address
-    NetUnparser::u32(ret, dst);  // dst address
+    NetUnparser::u32(out, src);  // src address
+    NetUnparser::u32(out, dst);  // dst address
 
-    ret.resize(4 * hlen);  // expand header to advertised size
+    fill(out, end, 0);  // expand header to advertised size
+}
 
-    return ret;
+//! \details The header is serialized into stack memory to be summed, so no allocation is needed.
+void IPv4Header::compute_cksum() {
+    array<uint8_t, 60> scratch{};  // maximum IPv4 header length
+    cksum = 0;
+    serialize_into(scratch.data(), scratch.size());
+
+    InternetChecksum check;
+    check.add({reinterpret_cast<const char *>(scratch.data()), 4 * size_t(hlen)});
+    cksum = check.value();
 }
 
 uint16_t IPv4Header::payload_length() const { return len - 4 * hlen; }
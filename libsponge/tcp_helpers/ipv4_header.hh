@@ -8,7 +8,9 @@
 struct IPv4Header {
     static constexpr size_t LENGTH = 20;         //!< [IPv4](\ref rfc::rfc791) header length, not including options
     static constexpr uint8_t DEFAULT_TTL = 128;  //!< A reasonable default TTL value
+    static constexpr uint8_t PROTO_ICMP = 1;     //!< Protocol number for ICMP
     static constexpr uint8_t PROTO_TCP = 6;      //!< Protocol number for [tcp](\ref rfc::rfc793)
+    static constexpr uint8_t PROTO_UDP = 17;     //!< Protocol number for UDP
 
     //! \struct IPv4Header
     //! ~~~{.txt}
@@ -52,6 +54,12 @@ struct IPv4Header {
     //! Serialize the IP fields
     std::string serialize() const;
 
+    //! Serialize the IP fields into `capacity` bytes of preallocated memory at `out`
+    void serialize_into(uint8_t *out, const size_t capacity) const;
+
+    //! Set `cksum` to the correct checksum of the other fields
+    void compute_cksum();
+
     //! Length of the payload
     uint16_t payload_length() const;
 
@@ -0,0 +1,146 @@
+#include "ipv4_reassembler.hh"
+
+#include <iterator>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+size_t IPv4Reassembler::KeyHash::operator()(const Key &key) const {
+    // MurmurHash3's 64-bit finalizer, over the fields packed together
+    uint64_t h = (uint64_t(key.src) << 32 | key.dst) ^ (uint64_t(key.id) << 8 | key.proto) * 0x9e37'79b9'7f4a'7c15;
+    h ^= h >> 33;
+    h *= 0xff51'afd7'ed55'8ccd;
+    h ^= h >> 33;
+    h *= 0xc4ce'b9fe'1a85'ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+//! \param[in] timeout milliseconds a datagram has to be completed in
+//! \param[in] max_datagrams most datagrams that may be in progress at once
+//! \param[in] max_bytes most fragment payload bytes that may be held at once
+IPv4Reassembler::IPv4Reassembler(const size_t timeout, const size_t max_datagrams, const size_t max_bytes)
+    : _timeout(timeout), _max_datagrams(max_datagrams), _max_bytes(max_bytes) {}
+
+//! \details A fragment is ignored if its payload isn't a multiple of 8 bytes long when more fragments follow
+//! it, or if it would make the datagram longer than an IPv4 datagram can be. A fragment that overlaps one
+//! already held, other than an exact copy, or that disagrees about where the datagram ends, discards the
+//! datagram: there's no telling which of the two versions is right.
+optional<InternetDatagram> IPv4Reassembler::push(const InternetDatagram &dgram) {
+    if (not dgram.is_fragment()) {
+        return dgram;
+    }
+
+    const IPv4Header &header = dgram.header();
+    const size_t size = dgram.payload().size();
+    const size_t start = 8 * size_t(header.offset);
+    const size_t end = start + size;
+    if (size == 0 or (header.mf and size % 8 != 0) or end + 4 * header.hlen > 0xffff or size > _max_bytes) {
+        _stats.bad_fragments++;
+        return {};
+    }
+
+    // make room, oldest datagrams first (possibly including this fragment's own)
+    while (_stats.buffered_bytes + size > _max_bytes) {
+        _evict_oldest();
+    }
+
+    const Key key{header.src, header.dst, header.id, header.proto};
+    auto it = _partials.find(key);
+    if (it == _partials.end()) {
+        if (_partials.size() >= _max_datagrams) {
+            _evict_oldest();
+        }
+        it = _partials.emplace(key, Partial{}).first;
+        it->second.serial = _next_serial++;
+        it->second.expires_at = _now + _timeout;
+        _by_age.emplace(it->second.serial, key);
+    }
+    Partial &partial = it->second;
+
+    // the neighboring fragments: the first one starting at or after this one, and the one before that
+    const auto following = partial.pieces.lower_bound(start);
+    if (following != partial.pieces.end() and following->first == start and following->second.size() == size) {
+        _stats.duplicates++;
+        return {};
+    }
+    const bool overlaps_next = following != partial.pieces.end() and following->first < end;
+    const bool overlaps_prev =
+        following != partial.pieces.begin() and prev(following)->first + prev(following)->second.size() > start;
+
+    // the datagram's length: given by the last fragment, and nothing may go past it
+    bool inconsistent = partial.total.has_value() and (end > partial.total.value() or
+                                                       (not header.mf and end != partial.total.value()));
+    if (not header.mf and not partial.pieces.empty()) {
+        const auto &last = *partial.pieces.rbegin();
+        inconsistent |= last.first + last.second.size() > end;
+    }
+
+    if (overlaps_next or overlaps_prev or inconsistent or partial.pieces.size() >= MAX_FRAGMENTS) {
+        _stats.dropped_overlap++;
+        _discard(key);
+        return {};
+    }
+
+    if (start == 0) {
+        partial.header = header;
+    }
+    if (not header.mf) {
+        partial.total = end;
+    }
+    partial.pieces.emplace(start, Buffer(dgram.payload().concatenate()));
+    partial.bytes += size;
+    _stats.buffered_bytes += size;
+
+    // with no overlaps, the fragments cover the whole datagram exactly when their lengths add up to it
+    if (not partial.total.has_value() or partial.bytes != partial.total.value()) {
+        return {};
+    }
+
+    string payload;
+    payload.reserve(partial.bytes);
+    for (const auto &piece : partial.pieces) {
+        payload.append(piece.second.str());
+    }
+
+    InternetDatagram whole;
+    whole.header() = partial.header.value();
+    whole.header().mf = false;
+    whole.header().offset = 0;
+    whole.header().len = 4 * whole.header().hlen + payload.size();
+    whole.payload() = Buffer(move(payload));
+
+    _stats.reassembled++;
+    _discard(key);
+    return whole;
+}
+
+//! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
+void IPv4Reassembler::tick(const size_t ms_since_last_tick) {
+    _now += ms_since_last_tick;
+
+    // every datagram gets the same timeout, so they expire in order of age
+    while (not _by_age.empty() and _partials.at(_by_age.begin()->second).expires_at <= _now) {
+        _stats.dropped_timeout++;
+        _discard(_by_age.begin()->second);
+    }
+}
+
+void IPv4Reassembler::_discard(const Key &key) {
+    const auto it = _partials.find(key);
+    if (it == _partials.end()) {
+        return;
+    }
+    _stats.buffered_bytes -= it->second.bytes;
+    _by_age.erase(it->second.serial);
+    _partials.erase(it);
+}
+
+void IPv4Reassembler::_evict_oldest() {
+    if (_by_age.empty()) {
+        return;
+    }
+    _stats.dropped_evicted++;
+    _discard(_by_age.begin()->second);
+}
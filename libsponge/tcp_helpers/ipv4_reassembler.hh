@@ -0,0 +1,105 @@
+#ifndef SPONGE_LIBSPONGE_IPV4_REASSEMBLER_HH
+#define SPONGE_LIBSPONGE_IPV4_REASSEMBLER_HH
+
+#include "buffer.hh"
+#include "ipv4_datagram.hh"
+#include "ipv4_header.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+//! \brief Puts fragmented IPv4 datagrams back together
+//! \details Fragments are grouped by (source, destination, identification, protocol). Since every fragment
+//! held costs memory that a sender can claim at will, the table is bounded: a datagram must be complete
+//! within a timeout, overlapping fragments discard the datagram they belong to (as RFC 5722 asks for IPv6),
+//! and when the limits on datagrams or bytes held are reached, the oldest datagram goes first.
+class IPv4Reassembler {
+  public:
+    //! Milliseconds a datagram has to be completed in, from its first fragment's arrival
+    static constexpr size_t DEFAULT_TIMEOUT = 30000;
+    //! Most datagrams that may be in progress at once
+    static constexpr size_t DEFAULT_MAX_DATAGRAMS = 64;
+    //! Most fragment payload bytes that may be held at once
+    static constexpr size_t DEFAULT_MAX_BYTES = 256 * 1024;
+    //! Most fragments a datagram may be made of
+    static constexpr size_t MAX_FRAGMENTS = 64;
+
+    //! Counters for monitoring
+    struct Stats {
+        size_t buffered_bytes{};     //!< Fragment payload bytes held now
+        uint64_t reassembled{};      //!< Datagrams completed
+        uint64_t duplicates{};       //!< Fragments ignored as copies of ones already held
+        uint64_t bad_fragments{};    //!< Fragments ignored as malformed
+        uint64_t dropped_overlap{};  //!< Datagrams discarded for overlapping, inconsistent or too many fragments
+        uint64_t dropped_timeout{};  //!< Datagrams discarded for not being completed in time
+        uint64_t dropped_evicted{};  //!< Datagrams discarded to make room for others
+    };
+
+  private:
+    //! The fields that tell which datagram a fragment belongs to
+    struct Key {
+        uint32_t src{};
+        uint32_t dst{};
+        uint16_t id{};
+        uint8_t proto{};
+
+        bool operator==(const Key &other) const {
+            return src == other.src and dst == other.dst and id == other.id and proto == other.proto;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key &key) const;
+    };
+
+    //! A datagram some of whose fragments have arrived
+    struct Partial {
+        std::optional<IPv4Header> header{};  //!< Header of the first fragment, once it has arrived
+        std::map<size_t, Buffer> pieces{};   //!< Fragment payloads, by byte offset
+        std::optional<size_t> total{};       //!< Payload length, once the last fragment has arrived
+        size_t bytes{};                      //!< Sum of the lengths of `pieces`
+        uint64_t serial{};                   //!< Order of arrival among datagrams, and key in `_by_age`
+        size_t expires_at{};                 //!< When it is discarded if still incomplete
+    };
+
+    size_t _timeout;
+    size_t _max_datagrams;
+    size_t _max_bytes;
+
+    std::unordered_map<Key, Partial, KeyHash> _partials{};
+    std::map<uint64_t, Key> _by_age{};  //!< The datagrams in progress, oldest (and so first to expire) first
+    uint64_t _next_serial{0};
+    size_t _now{0};  //!< Milliseconds elapsed, as told by tick()
+    Stats _stats{};
+
+    //! Forget a datagram in progress and its fragments
+    void _discard(const Key &key);
+
+    //! Discard the oldest datagram in progress
+    void _evict_oldest();
+
+  public:
+    //! Construct a reassembler with the given limits
+    explicit IPv4Reassembler(const size_t timeout = DEFAULT_TIMEOUT,
+                             const size_t max_datagrams = DEFAULT_MAX_DATAGRAMS,
+                             const size_t max_bytes = DEFAULT_MAX_BYTES);
+
+    //! \brief Take in a datagram, which may be a fragment
+    //! \returns a datagram that isn't a fragment unchanged, and for a fragment, the whole datagram if
+    //! this was its last missing piece, or nothing otherwise
+    std::optional<InternetDatagram> push(const InternetDatagram &dgram);
+
+    //! \brief Called periodically when time elapses; discards datagrams that have timed out
+    void tick(const size_t ms_since_last_tick);
+
+    //! Number of datagrams in progress
+    size_t datagrams_in_progress() const { return _partials.size(); }
+
+    //! Counters for monitoring
+    const Stats &stats() const { return _stats; }
+};
+
+#endif  // SPONGE_LIBSPONGE_IPV4_REASSEMBLER_HH
@@ -66,6 +66,9 @@ class LossyFdAdapter {
     void tick(const size_t ms_since_last_tick) {
         _adapter.tick(ms_since_last_tick);
     }  //!< FdAdapterBase::tick passthrough
+    std::optional<size_t> take_path_mtu_report() {
+        return _adapter.take_path_mtu_report();
+    }  //!< FdAdapterBase::take_path_mtu_report passthrough
     //!@}
 };
 
@@ -11,14 +11,32 @@
 //! Config for TCP sender and receiver
 class TCPConfig {
   public:
-    static constexpr size_t DEFAULT_CAPACITY = 64000;  //!< Default capacity
-    static constexpr size_t MAX_PAYLOAD_SIZE = 1000;   //!< Conservative max payload size for real Internet
-    static constexpr uint16_t TIMEOUT_DFLT = 1000;     //!< Default re-transmit timeout is 1 second
-    static constexpr unsigned MAX_RETX_ATTEMPTS = 8;   //!< Maximum re-transmit attempts before giving up
+    static constexpr size_t DEFAULT_CAPACITY = 64000;      //!< Default capacity
+    static constexpr size_t MAX_PAYLOAD_SIZE = 1000;       //!< Conservative max payload size for real Internet
+    static constexpr size_t MIN_PAYLOAD_SIZE = 536;        //!< Max payload size every IPv4 path carries (RFC 879)
+    static constexpr uint16_t TIMEOUT_DFLT = 1000;         //!< Default re-transmit timeout is 1 second
+    static constexpr unsigned MAX_RETX_ATTEMPTS = 8;       //!< Maximum re-transmit attempts before giving up
+    static constexpr uint16_t DELAYED_ACK_TIMEOUT = 40;    //!< A typical delayed-ACK timer (RFC 1122 allows 500 ms)
+    static constexpr uint16_t CORK_TIMEOUT_DFLT = 200;     //!< Longest a cork holds data back, as in Linux
+    static constexpr uint16_t SWS_OVERRIDE_TIMEOUT = 200;  //!< Longest SWS avoidance holds data back (RFC 1122)
+    static constexpr uint32_t KEEPALIVE_INTVL = 75000;     //!< Default time between keepalive probes, as in Linux
+    static constexpr unsigned KEEPALIVE_PROBES = 9;        //!< Default unanswered keepalive probes before giving up
 
-    uint16_t rt_timeout = TIMEOUT_DFLT;       //!< Initial value of the retransmission timeout, in milliseconds
-    size_t recv_capacity = DEFAULT_CAPACITY;  //!< Receive capacity, in bytes
-    size_t send_capacity = DEFAULT_CAPACITY;  //!< Sender capacity, in bytes
+    uint16_t rt_timeout = TIMEOUT_DFLT;            //!< Initial value of the retransmission timeout, in milliseconds
+    size_t recv_capacity = DEFAULT_CAPACITY;       //!< Receive capacity, in bytes
+    size_t recv_capacity_max = 0;                  //!< Largest receive capacity auto-tuning may grow to (0 for fixed)
+    size_t send_capacity = DEFAULT_CAPACITY;       //!< Sender capacity, in bytes
+    size_t mss = MAX_PAYLOAD_SIZE;                 //!< Initial max payload size of a segment
+    size_t mss_probe_limit = MAX_PAYLOAD_SIZE;     //!< Largest max payload size to probe the path for (`mss` for none)
+    uint16_t ack_delay = 0;                        //!< Longest an ACK may be held back, in milliseconds (0 for never)
+    bool nagle = false;                            //!< Hold back short segments while data is unacknowledged
+    bool sws_avoidance = false;                    //!< Avoid silly window syndrome, sending and receiving (RFC 1122)
+    uint16_t cork_timeout = CORK_TIMEOUT_DFLT;     //!< Longest TCPConnection::cork() holds data back, in milliseconds
+    uint64_t pacing_rate = 0;                      //!< Bytes per second to pace segments out at (0 for no pacing)
+    bool syn_cookies = false;                      //!< Answer SYNs with cookies when a TCPListener's SYN queue is full
+    uint32_t keepalive_idle = 0;                   //!< Idle ms before the first keepalive probe (0 for no keepalive)
+    uint32_t keepalive_intvl = KEEPALIVE_INTVL;    //!< Milliseconds between keepalive probes
+    unsigned keepalive_probes = KEEPALIVE_PROBES;  //!< Unanswered keepalive probes before the connection is reset
     std::optional<WrappingInt32> fixed_isn{};
 };
 
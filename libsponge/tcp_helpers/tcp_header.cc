@@ -1,5 +1,6 @@
 #include "tcp_header.hh"
 
+#include <algorithm>
 #include <sstream>
 
 using namespace std;
@@ -15,13 +16,22 @@ using namespace std;
 //! - there is less data in the header than the `doff` field claims
 //! - the checksum is bad
 ParseResult TCPHeader::parse(NetParser &p) {
-    sport = p.u16();                 // source port
-    dport = p.u16();                 // destination port
-    seqno = WrappingInt32{p.u32()};  // sequence number
-    ackno = WrappingInt32{p.u32()};  // ack number
-    doff = p.u8() >> 4;              // data offset
+    // one bounds check covers all the fixed fields
+    const uint8_t *const raw = p.peek(TCPHeader::LENGTH);
+    if (not raw) {
+        // as when the fields were read one by one: a `doff` that's cut off, or under 5, makes the header too short
+        const Buffer rest = p.buffer();
+        const uint8_t doff_seen = rest.size() > 12 ? rest.at(12) >> 4 : 0;
+        return doff_seen < 5 ? ParseResult::HeaderTooShort : p.get_error();
+    }
+
+    sport = NetParser::load_u16(raw);                     // source port
+    dport = NetParser::load_u16(raw + 2);                 // destination port
+    seqno = WrappingInt32{NetParser::load_u32(raw + 4)};  // sequence number
+    ackno = WrappingInt32{NetParser::load_u32(raw + 8)};  // ack number
+    doff = raw[12] >> 4;                                  // data offset
 
-    const uint8_t fl_b = p.u8();                  // byte including flags
+    const uint8_t fl_b = raw[13];                 // byte including flags
     urg = static_cast<bool>(fl_b & 0b0010'0000);  // binary literals and ' digit separator since C++14!!!
     ack = static_cast<bool>(fl_b & 0b0001'0000);
     psh = static_cast<bool>(fl_b & 0b0000'1000);
@@ -29,9 +39,10 @@ ParseResult TCPHeader::parse(NetParser &p) {
     syn = static_cast<bool>(fl_b & 0b0000'0010);
     fin = static_cast<bool>(fl_b & 0b0000'0001);
 
-    win = p.u16();    // window size
-    cksum = p.u16();  // checksum
-    uptr = p.u16();   // urgent pointer
+    win = NetParser::load_u16(raw + 14);    // window size
+    cksum = NetParser::load_u16(raw + 16);  // checksum
+    uptr = NetParser::load_u16(raw + 18);   // urgent pointer
+    p.remove_prefix(TCPHeader::LENGTH);
 
     if (doff < 5) {
         return ParseResult::HeaderTooShort;
@@ -49,32 +60,41 @@ ParseResult TCPHeader::parse(NetParser &p) {
 
 //! Serialize the TCPHeader to a string (does not recompute the checksum)
 string TCPHeader::serialize() const {
-    // sanity check
+    string ret(4 * doff, 0);
+    serialize_into(reinterpret_cast<uint8_t *>(ret.data()), ret.size());
+    return ret;
+}
+
+//! \param[out] out is where the header is written (exactly `4 * doff` bytes, zero-padded past the fixed fields)
+//! \param[in] capacity is the space available at `out`
+//! \note Does not recompute the checksum
+void TCPHeader::serialize_into(uint8_t *out, const size_t capacity) const {
+    // sanity checks
     if (doff < 5) {
         throw runtime_error("TCP header too short");
     }
+    if (capacity < 4 * size_t(doff)) {
+        throw runtime_error("TCPHeader::serialize_into: not enough room");
+    }
 
-    string ret;
-    ret.reserve(4 * doff);
+    uint8_t *const end = out + 4 * doff;
 
-    NetUnparser::u16(ret, sport);              // source port
-    NetUnparser::u16(ret, dport);              // destination port
-    NetUnparser::u32(ret, seqno.raw_value());  // sequence number
-    NetUnparser::u32(ret, ackno.raw_value());  // ack number
-    NetUnparser::u8(ret, doff << 4);           // data offset
+    NetUnparser::u16(out, sport);              // source port
+    NetUnparser::u16(out, dport);              // destination port
+    NetUnparser::u32(out, seqno.raw_value());  // sequence number
+    NetUnparser::u32(out, ackno.raw_value());  // ack number
+    NetUnparser::u8(out, doff << 4);           // data offset
 
     const uint8_t fl_b = (urg ? 0b0010'0000 : 0) | (ack ? 0b0001'0000 : 0) | (psh ? 0b0000'1000 : 0) |
                          (rst ? 0b0000'0100 : 0) | (syn ? 0b0000'0010 : 0) | (fin ? 0b0000'0001 : 0);
-    NetUnparser::u8(ret, fl_b);  // flags
-    NetUnparser::u16(ret, win);  // window size
+    NetUnparser::u8(out, fl_b);  // flags
+    NetUnparser::u16(out, win);  // window size
 
-    NetUnparser::u16(ret, cksum);  // checksum
+    NetUnparser::u16(out, cksum);  // checksum
 
-    NetUnparser::u16(ret, uptr);  // urgent pointer
+    NetUnparser::u16(out, uptr);  // urgent pointer
 
-    ret.resize(4 * doff);  // expand header to advertised size
-
-    return ret;
+    fill(out, end, 0);  // expand header to advertised size
 }
 
 //! \returns A string with the header's contents
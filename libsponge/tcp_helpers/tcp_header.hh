@@ -56,6 +56,9 @@ struct TCPHeader {
     //! Serialize the TCP fields
     std::string serialize() const;
 
+    //! Serialize the TCP fields into `capacity` bytes of preallocated memory at `out`
+    void serialize_into(uint8_t *out, const size_t capacity) const;
+
     //! Return a string containing a header in human-readable format
     std::string to_string() const;
 
@@ -0,0 +1,408 @@
+#include "tcp_listener.hh"
+
+#include "ipv4_header.hh"
+#include "parser.hh"
+#include "tcp_state.hh"
+#include "util.hh"
+
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+uint64_t rotl(const uint64_t x, const int bits) { return (x << bits) | (x >> (64 - bits)); }
+
+//! SipHash-2-4 (Aumasson and Bernstein) of `words`, under `key`
+template <size_t N>
+uint64_t siphash(const array<uint64_t, 2> &key, const array<uint64_t, N> &words) {
+    uint64_t v0 = key[0] ^ 0x736f'6d65'7073'6575;
+    uint64_t v1 = key[1] ^ 0x646f'7261'6e64'6f6d;
+    uint64_t v2 = key[0] ^ 0x6c79'6765'6e65'7261;
+    uint64_t v3 = key[1] ^ 0x7465'6462'7974'6573;
+    const auto sip_round = [&] {
+        v0 += v1;
+        v1 = rotl(v1, 13) ^ v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16) ^ v2;
+        v0 += v3;
+        v3 = rotl(v3, 21) ^ v0;
+        v2 += v1;
+        v1 = rotl(v1, 17) ^ v2;
+        v2 = rotl(v2, 32);
+    };
+    const auto compress = [&](const uint64_t m) {
+        v3 ^= m;
+        sip_round();
+        sip_round();
+        v0 ^= m;
+    };
+
+    for (const uint64_t word : words) {
+        compress(word);
+    }
+    compress(uint64_t(N * 8) << 56);
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) {
+        sip_round();
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+}  // namespace
+
+size_t TCPListener::FourTupleHash::operator()(const FourTuple &tuple) const {
+    // MurmurHash3's 64-bit finalizer, over the fields packed together
+    uint64_t h = (uint64_t(tuple.remote_address) << 32 | tuple.local_address) ^
+                 (uint64_t(tuple.remote_port) << 16 | tuple.local_port) * 0x9e37'79b9'7f4a'7c15;
+    h ^= h >> 33;
+    h *= 0xff51'afd7'ed55'8ccd;
+    h ^= h >> 33;
+    h *= 0xc4ce'b9fe'1a85'ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+//! \param[in] cfg configuration for each connection accepted
+//! \param[in] local address and port to listen on
+//! \param[in] backlog most established connections that may wait for accept()
+//! \param[in] syn_backlog most connections whose handshake may be under way at once
+TCPListener::TCPListener(const TCPConfig &cfg, const Address &local, const size_t backlog, const size_t syn_backlog)
+    : _cfg(cfg), _local(local), _backlog(backlog), _syn_backlog(syn_backlog) {
+    mt19937 rng = get_random_generator();
+    for (auto &half : _cookie_key) {
+        half = uint64_t(rng()) << 32 | rng();
+    }
+}
+
+void TCPListener::datagram_received(const InternetDatagram &dgram) {
+    const uint32_t local_address = _local.ipv4_numeric();
+    if (local_address != 0 and dgram.header().dst != local_address) {
+        return;
+    }
+    if (dgram.header().proto != IPv4Header::PROTO_TCP) {
+        return;
+    }
+
+    // is it a fragment? if so, wait for the rest of the datagram
+    if (dgram.is_fragment()) {
+        const optional<InternetDatagram> whole = _reassembler.push(dgram);
+        if (whole.has_value()) {
+            datagram_received(whole.value());
+        }
+        return;
+    }
+
+    TCPSegment seg;
+    if (seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError or
+        seg.header().dport != _local.port()) {
+        return;
+    }
+
+    const FourTuple tuple{dgram.header().dst, seg.header().dport, dgram.header().src, seg.header().sport};
+    const auto it = _connections.find(tuple);
+    if (it != _connections.end()) {
+        // with the accept queue full, a handshake can't complete: drop its final ACK, so the peer tries again
+        // later (as Linux does)
+        if (it->second.stage == Stage::HalfOpen and _accept_queue.size() >= _backlog and seg.header().ack and
+            not seg.header().rst) {
+            _stats.accept_queue_drops++;
+            return;
+        }
+        _catch_up(it->second);
+        it->second.connection.segment_received(seg);
+        _collect(tuple, it->second);
+        _settle(tuple, it->second);
+        return;
+    }
+
+    const TCPHeader &header = seg.header();
+    if (_cfg.syn_cookies and header.ack and not header.syn and not header.rst and _accept_cookie(tuple, seg)) {
+        return;
+    }
+    if (not header.syn or header.ack or header.rst) {
+        _send_reset(tuple, seg);
+        return;
+    }
+
+    // a SYN from a new peer: is there room for another connection?
+    _stats.syns_received++;
+    if (_accept_queue.size() >= _backlog) {
+        _stats.accept_queue_drops++;
+        return;
+    }
+    if (_half_open >= _syn_backlog) {
+        if (_cfg.syn_cookies) {
+            _send_cookie(tuple, seg);
+        } else {
+            _stats.syn_queue_drops++;
+        }
+        return;
+    }
+
+    Entry &entry = _connections.emplace(piecewise_construct, forward_as_tuple(tuple), forward_as_tuple(_cfg, _time))
+                       .first->second;
+    _half_open++;
+    entry.connection.segment_received(seg);
+    _collect(tuple, entry);
+    _settle(tuple, entry);
+}
+
+void TCPListener::tick(const size_t ms_since_last_tick) {
+    _time += ms_since_last_tick;
+    _reassembler.tick(ms_since_last_tick);
+
+    // parked connections whose keepalive is due are ticked along with the busy ones
+    vector<FourTuple> expired;
+    _wheel.advance(_time, expired);
+    for (const auto &tuple : expired) {
+        const auto it = _connections.find(tuple);
+        if (it == _connections.end()) {
+            continue;  // forgotten since
+        }
+        Entry &entry = it->second;
+        entry.timer_pending = false;
+        if (not entry.parked) {
+            continue;
+        }
+        if (entry.wake_at <= _time) {
+            _wake(tuple, entry);
+        } else {
+            // parked again since, until later
+            _wheel.schedule(tuple, entry.wake_at);
+            entry.timer_pending = true;
+            entry.timer_at = entry.wake_at;
+        }
+    }
+
+    const vector<FourTuple> busy(_busy.begin(), _busy.end());
+    vector<FourTuple> finished;
+    for (const auto &tuple : busy) {
+        Entry &entry = _connections.at(tuple);
+        _catch_up(entry);
+        _collect(tuple, entry);
+
+        const ByteStream &inbound = entry.connection.inbound_stream();
+        const bool unread = entry.stage == Stage::Accepted and not inbound.error() and not inbound.buffer_empty();
+        if (not entry.connection.active() and not unread) {
+            finished.push_back(tuple);
+        } else {
+            _settle(tuple, entry);
+        }
+    }
+    for (const auto &tuple : finished) {
+        _erase(tuple);
+    }
+}
+
+optional<FourTuple> TCPListener::accept() {
+    if (_accept_queue.empty()) {
+        return {};
+    }
+    const FourTuple tuple = _accept_queue.front();
+    _accept_queue.pop_front();
+    _connections.at(tuple).stage = Stage::Accepted;
+    _stats.accepted++;
+    return tuple;
+}
+
+TCPConnection *TCPListener::connection(const FourTuple &tuple) {
+    const auto it = _connections.find(tuple);
+    if (it == _connections.end()) {
+        return nullptr;
+    }
+    _wake(tuple, it->second);
+    return &it->second.connection;
+}
+
+void TCPListener::flush(const FourTuple &tuple) {
+    const auto it = _connections.find(tuple);
+    if (it != _connections.end()) {
+        _collect(tuple, it->second);
+        _settle(tuple, it->second);
+    }
+}
+
+void TCPListener::_collect(const FourTuple &tuple, Entry &entry) {
+    TCPConnection &conn = entry.connection;
+    while (not conn.segments_out().empty()) {
+        _send(tuple, conn.segments_out().front());
+        conn.segments_out().pop();
+    }
+
+    // a completed handshake moves the connection from the SYN queue to the accept queue
+    const TCPState state = conn.state();
+    if (entry.stage == Stage::HalfOpen and conn.active() and state != TCPState::State::SYN_RCVD and
+        state != TCPState::State::LISTEN) {
+        entry.stage = Stage::Ready;
+        _half_open--;
+        _accept_queue.push_back(tuple);
+    }
+}
+
+void TCPListener::_send(const FourTuple &tuple, TCPSegment &seg) {
+    seg.header().sport = tuple.local_port;
+    seg.header().dport = tuple.remote_port;
+
+    InternetDatagram dgram;
+    dgram.header().src = tuple.local_address;
+    dgram.header().dst = tuple.remote_address;
+    dgram.header().len = dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    dgram.payload() = seg.serialize(dgram.header().pseudo_cksum());
+    _datagrams_out.push(move(dgram));
+}
+
+void TCPListener::_send_reset(const FourTuple &tuple, const TCPSegment &seg) {
+    if (seg.header().rst) {
+        return;
+    }
+    _stats.unmatched++;
+
+    TCPSegment reset;
+    reset.header().rst = true;
+    if (seg.header().ack) {
+        reset.header().seqno = seg.header().ackno;
+    } else {
+        reset.header().ack = true;
+        reset.header().ackno = seg.header().seqno + seg.length_in_sequence_space();
+    }
+    _send(tuple, reset);
+}
+
+void TCPListener::_erase(const FourTuple &tuple) {
+    const auto it = _connections.find(tuple);
+    if (it == _connections.end()) {
+        return;
+    }
+    if (it->second.stage == Stage::HalfOpen) {
+        _half_open--;
+    } else if (it->second.stage == Stage::Ready) {
+        _accept_queue.erase(find(_accept_queue.begin(), _accept_queue.end(), tuple));
+    }
+    _busy.erase(tuple);
+    _connections.erase(it);
+}
+
+void TCPListener::_catch_up(Entry &entry) {
+    if (_time > entry.ticked) {
+        entry.connection.tick(_time - entry.ticked);
+    }
+    entry.ticked = _time;
+}
+
+void TCPListener::_wake(const FourTuple &tuple, Entry &entry) {
+    _catch_up(entry);
+    entry.parked = false;
+    _busy.insert(tuple);
+}
+
+void TCPListener::_settle(const FourTuple &tuple, Entry &entry) {
+    if (not entry.connection.active() or not entry.connection.idle()) {
+        _wake(tuple, entry);
+        return;
+    }
+
+    _busy.erase(tuple);
+    entry.parked = true;
+    const optional<size_t> due = entry.connection.keepalive_due();
+    if (not due.has_value()) {
+        entry.wake_at = numeric_limits<uint64_t>::max();  // only a segment or the owner wakes it
+        return;
+    }
+
+    // a connection needs only one timer: one already due sooner wakes it, or puts it back in the wheel
+    entry.wake_at = _time + due.value();
+    if (not entry.timer_pending or entry.timer_at > entry.wake_at) {
+        _wheel.schedule(tuple, entry.wake_at);
+        entry.timer_pending = true;
+        entry.timer_at = entry.wake_at;
+    }
+}
+
+uint64_t TCPListener::_cookie_hash(const FourTuple &tuple, const WrappingInt32 peer_isn, const uint64_t extra) const {
+    const array<uint64_t, 3> words{uint64_t(tuple.remote_address) << 32 | tuple.local_address,
+                                   uint64_t(tuple.remote_port) << 48 | uint64_t(tuple.local_port) << 32 |
+                                       peer_isn.raw_value(),
+                                   extra};
+    return siphash(_cookie_key, words);
+}
+
+//! \details The top byte holds the period's low 5 bits and the MSS index, masked with a hash of the SYN; the
+//! other 24 bits are a hash of the SYN, the period and the MSS index, which the final ACK has to return.
+uint32_t TCPListener::_cookie(const FourTuple &tuple,
+                              const WrappingInt32 peer_isn,
+                              const uint64_t period,
+                              const size_t mss_index) const {
+    const uint32_t mask = _cookie_hash(tuple, peer_isn, numeric_limits<uint64_t>::max()) >> 56;
+    const uint32_t top = ((period & 0x1f) << 3 | mss_index) ^ mask;
+    const uint32_t check = _cookie_hash(tuple, peer_isn, period << 3 | mss_index) & 0xff'ffff;
+    return top << 24 | check;
+}
+
+void TCPListener::_send_cookie(const FourTuple &tuple, const TCPSegment &syn) {
+    // the largest max payload size in the table that's no larger than the configured one
+    size_t mss_index = 0;
+    while (mss_index + 1 < COOKIE_MSS.size() and COOKIE_MSS[mss_index + 1] <= _cfg.mss) {
+        mss_index++;
+    }
+
+    TCPSegment syn_ack;
+    syn_ack.header().syn = true;
+    syn_ack.header().ack = true;
+    syn_ack.header().seqno = WrappingInt32{_cookie(tuple, syn.header().seqno, _time / COOKIE_PERIOD, mss_index)};
+    syn_ack.header().ackno = syn.header().seqno + 1;
+    syn_ack.header().win = min<size_t>(_cfg.recv_capacity, numeric_limits<uint16_t>::max());
+    _stats.cookies_sent++;
+    _send(tuple, syn_ack);
+}
+
+bool TCPListener::_accept_cookie(const FourTuple &tuple, const TCPSegment &seg) {
+    const WrappingInt32 cookie = seg.header().ackno - 1;
+    const WrappingInt32 peer_isn = seg.header().seqno - 1;
+
+    // undo the mask, and find the period and MSS index the cookie claims
+    const uint32_t mask = _cookie_hash(tuple, peer_isn, numeric_limits<uint64_t>::max()) >> 56;
+    const uint32_t top = (cookie.raw_value() >> 24) ^ mask;
+    const size_t mss_index = top & 0x7;
+    const uint64_t now = _time / COOKIE_PERIOD;
+    const uint64_t age = (now - (top >> 3)) & 0x1f;
+    if (mss_index >= COOKIE_MSS.size() or age > 1 or age > now) {
+        return false;
+    }
+    if (_cookie(tuple, peer_isn, now - age, mss_index) != cookie.raw_value()) {
+        return false;
+    }
+
+    if (_accept_queue.size() >= _backlog) {
+        _stats.accept_queue_drops++;
+        return true;
+    }
+
+    // make the connection the SYN would have, and replay the SYN to it (dropping its SYN/ACK, which the peer
+    // already has), then give it the final ACK
+    TCPConfig cfg = _cfg;
+    cfg.fixed_isn = cookie;
+    cfg.mss = COOKIE_MSS[mss_index];
+    Entry &entry = _connections.emplace(piecewise_construct, forward_as_tuple(tuple), forward_as_tuple(cfg, _time))
+                       .first->second;
+    _half_open++;
+    _stats.cookies_accepted++;
+
+    TCPSegment syn;
+    syn.header().syn = true;
+    syn.header().seqno = peer_isn;
+    syn.header().win = seg.header().win;
+    entry.connection.segment_received(syn);
+    entry.connection.segments_out() = {};
+
+    entry.connection.segment_received(seg);
+    _collect(tuple, entry);
+    _settle(tuple, entry);
+    return true;
+}
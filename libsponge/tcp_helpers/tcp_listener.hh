@@ -0,0 +1,195 @@
+#ifndef SPONGE_LIBSPONGE_TCP_LISTENER_HH
+#define SPONGE_LIBSPONGE_TCP_LISTENER_HH
+
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "ipv4_reassembler.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "timer_wheel.hh"
+#include "wrapping_integers.hh"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <unordered_map>
+#include <unordered_set>
+
+//! The addresses and ports that tell one TCP connection from another
+struct FourTuple {
+    uint32_t local_address{};
+    uint16_t local_port{};
+    uint32_t remote_address{};
+    uint16_t remote_port{};
+
+    bool operator==(const FourTuple &other) const {
+        return local_address == other.local_address and local_port == other.local_port and
+               remote_address == other.remote_address and remote_port == other.remote_port;
+    }
+};
+
+//! \brief Accepts TCP connections from many peers on one port, over IPv4
+//! \details Incoming datagrams are dispatched to their connection by looking up their 4-tuple in a hash table.
+//! A SYN from a new peer gets a connection of its own, which counts against the SYN queue until its handshake
+//! completes; then it waits in the accept queue until accept() hands it to the owner. Both queues are
+//! bounded, as listen(2)'s backlog bounds them: SYNs that would overfill them are dropped, and the peer will
+//! retry. The listener doesn't read or write a file descriptor itself: the owner passes in the datagrams it
+//! reads and sends the ones in datagrams_out().
+//!
+//! With TCPConfig::syn_cookies set, a SYN that finds the SYN queue full is answered with a SYN cookie instead
+//! of being dropped: the SYN/ACK's ISN encodes, under a keyed hash, what the listener needs to know about the
+//! SYN, so it keeps no state until the peer's final ACK returns the cookie. Only then is a TCPConnection
+//! allocated, so a SYN flood costs no memory.
+//!
+//! tick() only ticks the connections that have something to do. An idle one (see TCPConnection::idle()) is
+//! set aside until a segment arrives for it, the owner looks it up, or its keepalive is due, which a timer
+//! wheel keeps track of; then it's caught up with a single tick. So a listener with many idle connections
+//! costs little per tick.
+class TCPListener {
+  public:
+    //! Default bound on connections accepted but not yet taken by accept()
+    static constexpr size_t DEFAULT_BACKLOG = 128;
+    //! Default bound on connections whose handshake is under way
+    static constexpr size_t DEFAULT_SYN_BACKLOG = 256;
+    //! How long each timestamp in a SYN cookie lasts, in milliseconds; a cookie is good for one to two of them
+    static constexpr uint64_t COOKIE_PERIOD = 64000;
+    //! The max payload sizes a SYN cookie can encode
+    static constexpr std::array<uint16_t, 5> COOKIE_MSS{536, 1000, 1300, 1440, 1460};
+    //! Width of a slot in the keepalive timer wheel, in milliseconds
+    static constexpr uint64_t WHEEL_GRANULARITY = 100;
+    //! Slots in the keepalive timer wheel
+    static constexpr size_t WHEEL_SLOTS = 1024;
+
+    //! Counters for monitoring
+    struct Stats {
+        uint64_t syns_received{};       //!< SYNs that asked for a new connection
+        uint64_t syn_queue_drops{};     //!< SYNs dropped because the SYN queue was full
+        uint64_t accept_queue_drops{};  //!< SYNs and final ACKs dropped because the accept queue was full
+        uint64_t unmatched{};           //!< Segments for no connection, answered with a RST
+        uint64_t accepted{};            //!< Connections handed to the owner
+        uint64_t cookies_sent{};        //!< SYNs answered with a SYN cookie
+        uint64_t cookies_accepted{};    //!< Connections made from a valid SYN cookie
+    };
+
+  private:
+    struct FourTupleHash {
+        size_t operator()(const FourTuple &tuple) const;
+    };
+
+    //! Where a connection stands, as far as the listener is concerned
+    enum class Stage {
+        HalfOpen,  //!< Handshake under way: in the SYN queue
+        Ready,     //!< Established: in the accept queue
+        Accepted   //!< Handed to the owner
+    };
+
+    struct Entry {
+        TCPConnection connection;
+        Stage stage{Stage::HalfOpen};
+        uint64_t ticked;            //!< The listener's time when the connection was last ticked
+        bool parked{false};         //!< Is it idle, and left unticked?
+        uint64_t wake_at{0};        //!< When parked, the listener's time when its keepalive is due
+        bool timer_pending{false};  //!< Is a timer for it in the wheel?
+        uint64_t timer_at{0};       //!< If so, when that timer expires
+
+        Entry(const TCPConfig &cfg, const uint64_t now) : connection(cfg), ticked(now) {}
+    };
+
+    TCPConfig _cfg;
+    Address _local;
+    size_t _backlog;
+    size_t _syn_backlog;
+
+    std::unordered_map<FourTuple, Entry, FourTupleHash> _connections{};
+    std::deque<FourTuple> _accept_queue{};
+    size_t _half_open{0};  //!< Connections in the SYN queue
+
+    std::unordered_set<FourTuple, FourTupleHash> _busy{};          //!< Connections that tick() ticks
+    TimerWheel<FourTuple> _wheel{WHEEL_GRANULARITY, WHEEL_SLOTS};  //!< Keepalive timers of parked connections
+
+    IPv4Reassembler _reassembler{};
+    std::queue<InternetDatagram> _datagrams_out{};
+    Stats _stats{};
+
+    uint64_t _time{0};                      //!< Milliseconds since the listener was made
+    std::array<uint64_t, 2> _cookie_key{};  //!< Secret key for the SYN cookies' hash
+
+    //! Keyed hash of a SYN's 4-tuple and sequence number, and `extra`
+    uint64_t _cookie_hash(const FourTuple &tuple, const WrappingInt32 peer_isn, const uint64_t extra) const;
+
+    //! The SYN cookie for a SYN from `tuple` with sequence number `peer_isn`, at `period`
+    uint32_t _cookie(const FourTuple &tuple,
+                     const WrappingInt32 peer_isn,
+                     const uint64_t period,
+                     const size_t mss_index) const;
+
+    //! Answer `syn` with a SYN/ACK whose ISN is a SYN cookie, keeping no state
+    void _send_cookie(const FourTuple &tuple, const TCPSegment &syn);
+
+    //! \brief If `seg` returns a valid SYN cookie, make its connection, and return true
+    //! \details A valid cookie that finds the accept queue full is dropped (returning true too).
+    bool _accept_cookie(const FourTuple &tuple, const TCPSegment &seg);
+
+    //! Wrap the segments that the connection for `tuple` has to send, and update its stage
+    void _collect(const FourTuple &tuple, Entry &entry);
+
+    //! Wrap `seg` in an IPv4 datagram from the local to the remote end of `tuple`, and queue it to be sent
+    void _send(const FourTuple &tuple, TCPSegment &seg);
+
+    //! Answer a segment that belongs to no connection with a RST (RFC 793, "Reset Generation")
+    void _send_reset(const FourTuple &tuple, const TCPSegment &seg);
+
+    //! Forget the connection for `tuple`
+    void _erase(const FourTuple &tuple);
+
+    //! Tick the connection for all the time since it was last ticked
+    void _catch_up(Entry &entry);
+
+    //! Catch the connection up, and make sure it will be ticked from now on
+    void _wake(const FourTuple &tuple, Entry &entry);
+
+    //! Park the connection if it's idle (scheduling its keepalive), or else keep it ticked
+    void _settle(const FourTuple &tuple, Entry &entry);
+
+  public:
+    //! \brief Listen on `local` (whose address may be "0", for any) with the given connection configuration
+    TCPListener(const TCPConfig &cfg,
+                const Address &local,
+                const size_t backlog = DEFAULT_BACKLOG,
+                const size_t syn_backlog = DEFAULT_SYN_BACKLOG);
+
+    //! \brief Dispatch a datagram read from the network to its connection, or start a new one for a SYN
+    void datagram_received(const InternetDatagram &dgram);
+
+    //! \brief Called periodically when time elapses; forgets connections that have finished
+    //! \details An accepted connection is kept until it's inactive and its inbound stream has been read.
+    //! Only connections that aren't idle, or whose keepalive is due, are ticked.
+    void tick(const size_t ms_since_last_tick);
+
+    //! \brief Take the next established connection from the accept queue, if there is one
+    std::optional<FourTuple> accept();
+
+    //! \brief The connection for `tuple`, or nullptr if there is none
+    //! \details The connection is ticked from now on (as the owner may use it), until it's idle again.
+    //! \note Good until the next call to tick(), which may forget it once it has finished.
+    TCPConnection *connection(const FourTuple &tuple);
+
+    //! \brief Send what the owner has written to the connection for `tuple` (tick() also does)
+    void flush(const FourTuple &tuple);
+
+    //! \name Accessors
+    //!@{
+    std::queue<InternetDatagram> &datagrams_out() { return _datagrams_out; }
+    size_t connections() const { return _connections.size(); }
+    size_t syn_queue_length() const { return _half_open; }
+    size_t accept_queue_length() const { return _accept_queue.size(); }
+    size_t busy_connections() const { return _busy.size(); }
+    const Stats &stats() const { return _stats; }
+    //!@}
+};
+
+#endif  // SPONGE_LIBSPONGE_TCP_LISTENER_HH
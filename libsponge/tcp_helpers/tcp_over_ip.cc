@@ -1,18 +1,21 @@
 #include "tcp_over_ip.hh"
 
+#include "icmp_message.hh"
 #include "ipv4_datagram.hh"
 #include "ipv4_header.hh"
 #include "parser.hh"
 
 #include <arpa/inet.h>
 #include <stdexcept>
+#include <string>
 #include <unistd.h>
 #include <utility>
 
 using namespace std;
 
 //! \details This function attempts to parse a TCP segment from
-//! the IP datagram's payload.
+//! the IP datagram's payload. A fragment is held until the rest of its
+//! datagram arrives, and the segment is parsed from the whole datagram.
 //!
 //! If this succeeds, it then checks that the received segment is related to the
 //! current connection. When a TCP connection has been established, this means
@@ -30,6 +33,12 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
         return {};
     }
 
+    // is it an ICMP message? those come from routers along the path, not from our peer
+    if (ip_dgram.header().proto == IPv4Header::PROTO_ICMP) {
+        _icmp_received(ip_dgram);
+        return {};
+    }
+
     // is the IPv4 datagram from our peer?
     if (not listening() and (ip_dgram.header().src != config().destination.ipv4_numeric())) {
         return {};
@@ -40,6 +49,12 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
         return {};
     }
 
+    // is it a fragment? if so, wait for the rest of the datagram
+    if (ip_dgram.is_fragment()) {
+        const optional<InternetDatagram> whole = _reassembler.push(ip_dgram);
+        return whole.has_value() ? unwrap_tcp_in_ip(whole.value()) : nullopt;
+    }
+
     // is the payload a valid TCP segment?
     TCPSegment tcp_seg;
     if (ParseResult::NoError != tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum())) {
@@ -70,21 +85,75 @@ optional<TCPSegment> TCPOverIPv4Adapter::unwrap_tcp_in_ip(const InternetDatagram
     return tcp_seg;
 }
 
-//! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
-//! \param[in] seg is the TCP segment to convert
-InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
+//! Sets the port numbers in `seg`, and returns the IPv4 header that goes in front of it
+IPv4Header TCPOverIPv4Adapter::_ip_header_for(TCPSegment &seg) {
     // set the port numbers in the TCP segment
     seg.header().sport = config().source.port();
     seg.header().dport = config().destination.port();
 
-    // create an Internet Datagram and set its addresses and length
+    // create an IPv4 header and set its addresses and length
+    IPv4Header ip_header;
+    ip_header.src = config().source.ipv4_numeric();
+    ip_header.dst = config().destination.ipv4_numeric();
+    ip_header.len = ip_header.hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+
+    // routers mustn't fragment segments, but tell us they're too big (path MTU discovery)
+    ip_header.df = true;
+    return ip_header;
+}
+
+//! \details Only "fragmentation needed" is acted on, and only if the datagram it quotes is one of this
+//! connection's segments, so a forged message has to guess the connection's addresses and ports.
+void TCPOverIPv4Adapter::_icmp_received(const InternetDatagram &ip_dgram) {
+    ICMPMessage icmp;
+    if (listening() or icmp.parse(ip_dgram.payload()) != ParseResult::NoError or
+        icmp.type != ICMPMessage::TYPE_DESTINATION_UNREACHABLE or
+        icmp.code != ICMPMessage::CODE_FRAGMENTATION_NEEDED or icmp.next_hop_mtu() == 0) {
+        return;
+    }
+
+    // the quoted datagram: its IPv4 header, then (at least) the TCP ports
+    const string &quoted = icmp.original;
+    if (quoted.size() < IPv4Header::LENGTH) {
+        return;
+    }
+    const auto *raw = reinterpret_cast<const uint8_t *>(quoted.data());
+    const size_t header_len = 4 * (raw[0] & 0x0f);
+    if ((raw[0] >> 4) != 4 or header_len < IPv4Header::LENGTH or quoted.size() < header_len + 4) {
+        return;
+    }
+
+    const bool ours = raw[9] == IPv4Header::PROTO_TCP and
+                      NetParser::load_u32(raw + 12) == config().source.ipv4_numeric() and
+                      NetParser::load_u32(raw + 16) == config().destination.ipv4_numeric() and
+                      NetParser::load_u16(raw + header_len) == config().source.port() and
+                      NetParser::load_u16(raw + header_len + 2) == config().destination.port();
+    if (ours) {
+        report_path_mtu(icmp.next_hop_mtu());
+    }
+}
+
+//! Takes a TCP segment, sets port numbers as necessary, and wraps it in an IPv4 datagram
+//! \param[in] seg is the TCP segment to convert
+InternetDatagram TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg) {
     InternetDatagram ip_dgram;
-    ip_dgram.header().src = config().source.ipv4_numeric();
-    ip_dgram.header().dst = config().destination.ipv4_numeric();
-    ip_dgram.header().len = ip_dgram.header().hlen * 4 + seg.header().doff * 4 + seg.payload().size();
+    ip_dgram.header() = _ip_header_for(seg);
 
     // set payload, calculating TCP checksum using information from IP header
     ip_dgram.payload() = seg.serialize(ip_dgram.header().pseudo_cksum());
 
     return ip_dgram;
 }
+
+//! \details On return, `room` holds the IPv4 header followed by the TCP header, and the
+//! datagram is complete once `seg.payload()` is appended. Nothing is allocated on the heap.
+void TCPOverIPv4Adapter::wrap_tcp_in_ip(TCPSegment &seg, Headroom &room) {
+    IPv4Header ip_header = _ip_header_for(seg);
+
+    // TCP header first, since the IPv4 header goes in front of it
+    seg.serialize_into(room, ip_header.pseudo_cksum());
+
+    const size_t ip_header_len = 4 * ip_header.hlen;
+    ip_header.compute_cksum();
+    ip_header.serialize_into(room.prepend(ip_header_len), ip_header_len);
+}
@@ -4,6 +4,7 @@
 #include "buffer.hh"
 #include "fd_adapter.hh"
 #include "ipv4_datagram.hh"
+#include "ipv4_reassembler.hh"
 #include "tcp_segment.hh"
 
 #include <optional>
@@ -14,6 +15,25 @@ class TCPOverIPv4Adapter : public FdAdapterBase {
     std::optional<TCPSegment> unwrap_tcp_in_ip(const InternetDatagram &ip_dgram);
 
     InternetDatagram wrap_tcp_in_ip(TCPSegment &seg);
+
+    //! \brief Serialize the TCP and IPv4 headers for `seg` into `room`; the payload is left where it is
+    void wrap_tcp_in_ip(TCPSegment &seg, Headroom &room);
+
+    //! \brief Called periodically when time elapses, to time out incomplete fragmented datagrams
+    void tick(const size_t ms_since_last_tick) { _reassembler.tick(ms_since_last_tick); }
+
+    //! Access the reassembler for fragmented datagrams
+    const IPv4Reassembler &reassembler() const { return _reassembler; }
+
+  private:
+    //! Fragments of datagrams from the peer, waiting for the rest of their datagrams
+    IPv4Reassembler _reassembler{};
+
+    //! Set the port numbers in `seg` and return a matching IPv4 header
+    IPv4Header _ip_header_for(TCPSegment &seg);
+
+    //! Act on an ICMP message addressed to us
+    void _icmp_received(const InternetDatagram &ip_dgram);
 };
 
 #endif  // SPONGE_LIBSPONGE_TCP_OVER_IP_HH
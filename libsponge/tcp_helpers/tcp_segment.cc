@@ -3,6 +3,8 @@
 #include "parser.hh"
 #include "util.hh"
 
+#include <string>
+#include <utility>
 #include <variant>
 
 using namespace std;
@@ -19,6 +21,7 @@ ParseResult TCPSegment::parse(const Buffer buffer, const uint32_t datagram_layer
     NetParser p{buffer};
     _header.parse(p);
     _payload = p.buffer();
+    _payload_cksum.reset();
     return p.get_error();
 }
 
@@ -28,18 +31,48 @@ size_t TCPSegment::length_in_sequence_space() const {
 
 //! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
 BufferList TCPSegment::serialize(const uint32_t datagram_layer_checksum) const {
-    TCPHeader header_out = _header;
-    header_out.cksum = 0;
-
-    // calculate checksum -- taken over entire segment
-    InternetChecksum check(datagram_layer_checksum);
-    check.add(header_out.serialize());
-    check.add(_payload);
-    header_out.cksum = check.value();
+    string header(4 * _header.doff, 0);
+    _serialize_header(reinterpret_cast<uint8_t *>(header.data()), header.size(), datagram_layer_checksum);
 
     BufferList ret;
-    ret.append(header_out.serialize());
+    ret.append(move(header));
     ret.append(_payload);
 
     return ret;
 }
+
+//! \param[in,out] room is where the header is prepended; the caller sends `payload()` right after it
+//! \param[in] datagram_layer_checksum pseudo-checksum from the lower-layer protocol
+void TCPSegment::serialize_into(Headroom &room, const uint32_t datagram_layer_checksum) const {
+    const size_t header_len = 4 * _header.doff;
+    _serialize_header(room.prepend(header_len), header_len, datagram_layer_checksum);
+}
+
+void TCPSegment::_serialize_header(uint8_t *out, const size_t capacity, const uint32_t datagram_layer_checksum) const {
+    TCPHeader header_out = _header;
+    header_out.cksum = 0;
+    header_out.serialize_into(out, capacity);
+
+    // calculate checksum -- taken over entire segment, but the payload's share is cached,
+    // so re-serializing (e.g. a retransmission with a new ackno and window) only sums the header
+    InternetChecksum check(datagram_layer_checksum + payload_cksum());
+    check.add({reinterpret_cast<const char *>(out), 4 * size_t(header_out.doff)});
+
+    // patch the checksum into the bytes already written rather than serializing a second time
+    uint8_t *cksum_field = out + 16;
+    NetUnparser::u16(cksum_field, check.value());
+}
+
+//! \details The payload is immutable once the segment is built, so its share of the checksum
+//! never changes; caching it lets every later serialize() (with rewritten ports, ackno or window)
+//! patch the checksum in time proportional to the header, not the payload. Copies of the segment
+//! (e.g. the sender's retransmission record) share the cached value if it was computed first.
+//! \note The header always has an even length, so the payload's bytes are summed at even offsets.
+uint16_t TCPSegment::payload_cksum() const {
+    if (not _payload_cksum.has_value()) {
+        InternetChecksum check;
+        check.add(_payload);
+        _payload_cksum = check.partial_sum();
+    }
+    return _payload_cksum.value();
+}
@@ -5,6 +5,7 @@
 #include "tcp_header.hh"
 
 #include <cstdint>
+#include <optional>
 
 //! \brief [TCP](\ref rfc::rfc793) segment
 class TCPSegment {
@@ -12,6 +13,15 @@ class TCPSegment {
     TCPHeader _header{};
     Buffer _payload{};
 
+    //! Cached ones'-complement sum of the payload (see payload_cksum())
+    mutable std::optional<uint16_t> _payload_cksum{};
+
+    //! Earliest departure time, in microseconds on the sending TCPConnection's clock (not sent on the wire)
+    uint64_t _departure{0};
+
+    //! Write the header, with its checksum filled in, into `4 * doff` bytes at `out`
+    void _serialize_header(uint8_t *out, const size_t capacity, const uint32_t datagram_layer_checksum) const;
+
   public:
     //! \brief Parse the segment from a string
     ParseResult parse(const Buffer buffer, const uint32_t datagram_layer_checksum = 0);
@@ -19,15 +29,32 @@ class TCPSegment {
     //! \brief Serialize the segment to a string
     BufferList serialize(const uint32_t datagram_layer_checksum = 0) const;
 
+    //! \brief Serialize the header into `room`, in front of anything already there; the payload isn't copied
+    void serialize_into(Headroom &room, const uint32_t datagram_layer_checksum = 0) const;
+
     //! \name Accessors
     //!@{
     const TCPHeader &header() const { return _header; }
     TCPHeader &header() { return _header; }
 
     const Buffer &payload() const { return _payload; }
-    Buffer &payload() { return _payload; }
+    Buffer &payload() {
+        _payload_cksum.reset();
+        return _payload;
+    }
     //!@}
 
+    //! \name Earliest departure time (EDT), for pacing
+    //! \details Microseconds on the clock of the TCPConnection that sent the segment
+    //! (see TCPConnection::clock()); the segment shouldn't be sent before then. 0 means right away.
+    //!@{
+    uint64_t departure() const { return _departure; }
+    void set_departure(const uint64_t departure) { _departure = departure; }
+    //!@}
+
+    //! \brief Partial (uncomplemented) Internet checksum of the payload, computed once and cached
+    uint16_t payload_cksum() const;
+
     //! \brief Segment's length in sequence space
     //! \note Equal to payload length plus one byte if SYN is set, plus one byte if FIN is set
     size_t length_in_sequence_space() const;
@@ -5,6 +5,7 @@
 #include "tun.hh"
 #include "util.hh"
 
+#include <algorithm>
 #include <cstddef>
 #include <exception>
 #include <iostream>
@@ -25,7 +26,14 @@ template <typename AdaptT>
 void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
     auto base_time = timestamp_ms();
     while (condition()) {
-        auto ret = _eventloop.wait_next_event(TCP_TICK_MS);
+        // wake up in time for the next paced segment, if it's due before the next tick
+        int timeout = TCP_TICK_MS;
+        if (not _tcp->segments_out().empty() and not _segment_due()) {
+            const uint64_t wait_us = _tcp->segments_out().front().departure() - _tcp->clock();
+            timeout = min<uint64_t>(timeout, (wait_us + 999) / 1000);
+        }
+
+        auto ret = _eventloop.wait_next_event(timeout);
         if (ret == EventLoop::Result::Exit or _abort) {
             break;
         }
@@ -39,6 +47,11 @@ void TCPSpongeSocket<AdaptT>::_tcp_loop(const function<bool()> &condition) {
     }
 }
 
+template <typename AdaptT>
+bool TCPSpongeSocket<AdaptT>::_segment_due() {
+    return _tcp->segments_out().front().departure() <= _tcp->clock();
+}
+
 //! \param[in] data_socket_pair is a pair of connected AF_UNIX SOCK_STREAM sockets
 //! \param[in] datagram_interface is the interface for reading and writing datagrams
 template <typename AdaptT>
@@ -81,6 +94,12 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
                                 _tcp->segment_received(move(seg.value()));
                             }
 
+                            // the datagram may have been an ICMP message saying our segments are too big
+                            const auto path_mtu = _datagram_adapter.take_path_mtu_report();
+                            if (path_mtu) {
+                                _tcp->path_mtu_reported(path_mtu.value());
+                            }
+
                             // debugging output:
                             if (_thread_data.eof() and _tcp.value().bytes_in_flight() == 0 and not _fully_acked) {
                                 cerr << "DEBUG: Outbound stream to "
@@ -154,12 +173,13 @@ void TCPSpongeSocket<AdaptT>::_initialize_TCP(const TCPConfig &config) {
     _eventloop.add_rule(_datagram_adapter,
                         Direction::Out,
                         [&] {
-                            while (not _tcp->segments_out().empty()) {
+                            // paced segments wait for their departure time
+                            while (not _tcp->segments_out().empty() and _segment_due()) {
                                 _datagram_adapter.write(_tcp->segments_out().front());
                                 _tcp->segments_out().pop();
                             }
                         },
-                        [&] { return not _tcp->segments_out().empty(); });
+                        [&] { return not _tcp->segments_out().empty() and _segment_due(); });
 }
 
 //! \brief Call [socketpair](\ref man2::socketpair) and return connected Unix-domain sockets of specified type
@@ -40,6 +40,9 @@ class TCPSpongeSocket : public LocalStreamSocket {
     //! Process events while specified condition is true
     void _tcp_loop(const std::function<bool()> &condition);
 
+    //! Is the oldest outbound segment's earliest departure time (see TCPConfig::pacing_rate) here yet?
+    bool _segment_due();
+
     //! Main loop of TCPConnection thread
     void _tcp_main();
 
@@ -38,19 +38,33 @@ optional<TCPSegment> TCPOverIPv4OverEthernetAdapter::read() {
 
 //! \param[in] ms_since_last_tick the number of milliseconds since the last call to this method
 void TCPOverIPv4OverEthernetAdapter::tick(const size_t ms_since_last_tick) {
+    TCPOverIPv4Adapter::tick(ms_since_last_tick);
     _interface.tick(ms_since_last_tick);
     send_pending();
 }
 
 //! \param[in] seg the TCPSegment to send
+//! \details Usually the next hop's Ethernet address is known, and the Ethernet, IPv4 and TCP headers all go
+//! into the headroom in front of the segment's payload, as on the TUN path. Otherwise the datagram goes
+//! through the interface, to wait for the address or to be dropped for being too big.
 void TCPOverIPv4OverEthernetAdapter::write(TCPSegment &seg) {
+    _headroom.clear();
+    wrap_tcp_in_ip(seg, _headroom);
+    if (_interface.frame_into(_headroom, _headroom.size() + seg.payload().size(), _next_hop)) {
+        _tap.write_packet(_headroom.str(), seg.payload().str());
+        return;
+    }
+
     _interface.send_datagram(wrap_tcp_in_ip(seg), _next_hop);
     send_pending();
 }
 
 void TCPOverIPv4OverEthernetAdapter::send_pending() {
     while (not _interface.frames_out().empty()) {
-        _tap.write(_interface.frames_out().front().serialize());
+        const EthernetFrame &frame = _interface.frames_out().front();
+        _headroom.clear();
+        frame.serialize_into(_headroom);
+        _tap.write_packet(_headroom.str(), frame.payload());
         _interface.frames_out().pop();
     }
 }
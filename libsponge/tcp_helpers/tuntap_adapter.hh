@@ -13,6 +13,7 @@
 class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
   private:
     TunFD _tun;
+    Headroom _headroom{};  //!< scratch space for the headers of the datagram being written
 
   public:
     //! Construct from a TunFD
@@ -28,7 +29,11 @@ class TCPOverIPv4OverTunFdAdapter : public TCPOverIPv4Adapter {
     }
 
     //! Creates an IPv4 datagram from a TCP segment and writes it to the TUN device
-    void write(TCPSegment &seg) { _tun.write(wrap_tcp_in_ip(seg).serialize()); }
+    void write(TCPSegment &seg) {
+        _headroom.clear();
+        wrap_tcp_in_ip(seg, _headroom);
+        _tun.write_packet(_headroom.str(), seg.payload().str());
+    }
 
     //! Access the underlying TUN device
     operator TunFD &() { return _tun; }
@@ -49,6 +54,8 @@ class TCPOverIPv4OverEthernetAdapter : public TCPOverIPv4Adapter {
 
     Address _next_hop;  //!< IP address of the next hop
 
+    Headroom _headroom{};  //!< scratch space for the headers of the frame being sent
+
     void send_pending();  //!< Sends any pending Ethernet frames
 
   public:
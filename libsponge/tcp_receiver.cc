@@ -5,9 +5,14 @@
 // For Lab 2, please replace with a real implementation that passes the
 // automated checks run by `make check_lab2`.
 
+#include <algorithm>
+#include <limits>
+
 using namespace std;
 
 void TCPReceiver::segment_received(const TCPSegment &seg) {
+    this->_resize();
+
     bool syn = seg.header().syn;
     bool fin = seg.header().fin;
     auto seqno = seg.header().seqno;
@@ -26,6 +31,46 @@ void TCPReceiver::segment_received(const TCPSegment &seg) {
     this->_reassembler.push_substring(payload, index, fin);
 }
 
+size_t TCPReceiver::_full_window() const {
+    return min<size_t>(this->window_size(), numeric_limits<uint16_t>::max());
+}
+
+uint16_t TCPReceiver::advertise_window() {
+    this->_resize();
+
+    const uint64_t written = this->written_bytes();
+    size_t window = this->_full_window();
+    if (this->_sws_mss > 0 && written + window < this->_advertised_edge + this->_sws_threshold()){
+        // not a full step: keep the right edge where it was
+        window = min<uint64_t>(window, this->_advertised_edge > written ? this->_advertised_edge - written : 0);
+    }
+
+    this->_advertised_edge = max<uint64_t>(this->_advertised_edge, written + window);
+    return window;
+}
+
+bool TCPReceiver::window_update_due() const {
+    if (this->_sws_mss == 0 || !this->_ISN.has_value() || this->stream_out().input_ended()) return false;
+
+    return this->written_bytes() + this->_full_window() >= this->_advertised_edge + this->_sws_threshold();
+}
+
+void TCPReceiver::set_capacity(const size_t capacity) {
+    this->_capacity_target = capacity;
+    this->_resize();
+}
+
+void TCPReceiver::_resize() {
+    const size_t buffered = this->stream_out().buffer_size();
+    const uint64_t written = this->written_bytes();
+    const size_t promised = this->_advertised_edge > written ? this->_advertised_edge - written : 0;
+    const size_t capacity = max(this->_capacity_target, buffered + promised);
+    if (capacity == this->_capacity) return;
+
+    this->_capacity = capacity;
+    this->_reassembler.set_capacity(capacity);
+}
+
 optional<WrappingInt32> TCPReceiver::ackno() const {
     if (!this->_ISN.has_value()) return nullopt;
     
@@ -7,6 +7,7 @@
 #include "tcp_header.hh"
 #include "wrapping_integers.hh"
 
+#include <algorithm>
 #include <iostream>
 #include <optional>
 
@@ -23,6 +24,24 @@ class TCPReceiver {
     size_t _capacity;
     optional<WrappingInt32> _ISN;
 
+    //! The capacity asked for by set_capacity(); `_capacity` follows it as far as the advertised window allows
+    size_t _capacity_target;
+
+    //! The furthest stream index the window has been advertised to reach; it must never move back
+    uint64_t _advertised_edge{0};
+
+    //! Bring `_capacity` as close to `_capacity_target` as the advertised window allows
+    void _resize();
+
+    //! The peer's MSS, for silly window syndrome avoidance (0 for none)
+    size_t _sws_mss{0};
+
+    //! The least the window's right edge moves by when advertised: min(MSS, half the buffer) (RFC 1122)
+    size_t _sws_threshold() const { return std::max<size_t>(1, std::min(this->_sws_mss, this->_capacity / 2)); }
+
+    //! The window to advertise now, ignoring SWS avoidance
+    size_t _full_window() const;
+
   public:
     //! \brief Construct a TCP receiver
     //!
@@ -31,7 +50,8 @@ class TCPReceiver {
     TCPReceiver(const size_t capacity) : 
       _reassembler(capacity),
       _capacity(capacity),
-      _ISN(std::nullopt){};
+      _ISN(std::nullopt),
+      _capacity_target(capacity){};
 
     //! \name Accessors to provide feedback to the remote TCPSender
     //!@{
@@ -54,6 +74,31 @@ class TCPReceiver {
     //! accepted by the receiver) and (b) the sequence number of the
     //! beginning of the window (the ackno).
     size_t window_size() const {return this->_capacity - this->_reassembler.stream_out().buffer_size(); }
+
+    //! \brief The window size to put in a segment sent now, which the receiver then holds itself to
+    //! \note At most 65535, the largest window a TCP header carries without the window scale option
+    //! \details With silly window syndrome avoidance, the window's right edge only moves in steps of at least
+    //! min(MSS, half the buffer), so a slow reader doesn't invite the peer to send a stream of tiny segments.
+    uint16_t advertise_window();
+
+    //! \brief Would the window advertised now move its right edge a full step (see advertise_window())?
+    //! \details Only with silly window syndrome avoidance on: this is when a window update is worth sending.
+    bool window_update_due() const;
+
+    //! \brief Avoid silly window syndrome for a peer sending segments of up to `mss` bytes (0 to stop)
+    void set_sws_avoidance(const size_t mss) { _sws_mss = mss; }
+    //!@}
+
+    //! \name Buffer sizing
+    //!@{
+
+    //! \brief The maximum number of bytes the receiver stores now
+    size_t capacity() const { return _capacity; }
+
+    //! \brief Change the maximum number of bytes the receiver stores
+    //! \details Growing takes effect at once. Shrinking would take back window already advertised,
+    //! which RFC 793 forbids, so the capacity only comes down as the reader makes room.
+    void set_capacity(const size_t capacity);
     //!@}
 
     //! \brief number of bytes stored but not yet reassembled
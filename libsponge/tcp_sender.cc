@@ -4,7 +4,14 @@
 
 #include "tcp_config.hh"
 
+#include <algorithm>
+#include <deque>
+#include <iterator>
+#include <optional>
 #include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
 // Dummy implementation of a TCP sender
 
@@ -16,10 +23,18 @@ using namespace std;
 //! \param[in] capacity the capacity of the outgoing byte stream
 //! \param[in] retx_timeout the initial amount of time to wait before retransmitting the oldest outstanding segment
 //! \param[in] fixed_isn the Initial Sequence Number to use, if set (otherwise uses a random ISN)
-TCPSender::TCPSender(const size_t capacity, const uint16_t retx_timeout, const std::optional<WrappingInt32> fixed_isn)
+//! \param[in] mss the largest payload to put in a segment to begin with
+//! \param[in] mss_probe_limit the largest payload to probe the path for (path MTU discovery, RFC 4821)
+TCPSender::TCPSender(const size_t capacity,
+                     const uint16_t retx_timeout,
+                     const std::optional<WrappingInt32> fixed_isn,
+                     const size_t mss,
+                     const size_t mss_probe_limit)
     : _isn(fixed_isn.value_or(WrappingInt32{random_device()()}))
     , _initial_retransmission_timeout{retx_timeout}
     , _stream(capacity)
+    , _pkg_size(mss)
+    , _probe_limit(max(mss, mss_probe_limit))
     , _timer(RetransTimer(retx_timeout)) {
     }
 
@@ -35,18 +50,82 @@ void TCPSender::fill_window() {
     }
 
     uint64_t last_can_sent = this->_first_notaccept + (this->_first_notaccept == this->_first_unackno ? 1 : 0);
+    this->_sws_holding = false;
 
     while (this->_next_seqno < last_can_sent){
         int64_t size = min<uint64_t>(this->_stream.buffer_size(), this->_pkg_size);
         size = min<uint64_t>(size, last_can_sent - this->_next_seqno);
 
+        // probe for a larger MSS with real data, once the connection is up and there's a full probe's worth
+        if (!this->_probe.has_value() && this->_first_unackno > 0 &&
+            this->_probe_limit >= this->_pkg_size + this->_min_probe_gain &&
+            this->_stream.buffer_size() >= this->_probe_limit &&
+            last_can_sent - this->_next_seqno >= this->_probe_limit){
+            size = this->_probe_limit;
+            this->_probe = make_pair(this->_next_seqno, this->_probe_limit);
+        }
+
+        if (size < int64_t(this->_pkg_size) && this->_hold_short()) break;
+        if (size < int64_t(this->_pkg_size) && this->_sws_hold(size)){
+            this->_sws_holding = true;
+            break;
+        }
+
         this->send_package(
-            this->_stream.read(size),
+            this->_stream.read_buffer(size),
             this->_next_seqno
         );
 
         if (this->_stream.buffer_size() == 0) break;
     }
+
+    if (this->_stream.buffer_size() == 0){
+        this->_corked_for = 0;
+    }
+    if (!this->_sws_holding){
+        this->_sws_wait = 0;
+    }
+}
+
+//! \details Only data that is short of a package for want of data, rather than of window, is held back
+//! (a FIN never is): corked, until the cork's time limit is up; and with Nagle's algorithm, while
+//! anything sent is unacknowledged, so small writes go out together once the ACK comes back.
+bool TCPSender::_hold_short() const {
+    if (this->_stream.input_ended() || this->_stream.buffer_size() >= this->_pkg_size){
+        return false;
+    }
+    if (this->_corked && this->_corked_for < this->_cork_limit){
+        return true;
+    }
+    return this->_nagle && this->bytes_in_flight() > 0;
+}
+
+//! \details The sender's side of RFC 1122's algorithm: a segment short of a package goes if it takes all the
+//! data there is and nothing is unacknowledged, or if it fills at least half the largest window the receiver
+//! has offered. Otherwise it waits for the window to open, or at most TCPConfig::SWS_OVERRIDE_TIMEOUT ms.
+//! A zero-window probe always goes, or the window might never be seen to open.
+bool TCPSender::_sws_hold(const uint64_t size) const {
+    if (!this->_sws_avoidance || size == 0 || this->_first_notaccept == this->_first_unackno){
+        return false;
+    }
+    if (size == this->_stream.buffer_size() && (this->bytes_in_flight() == 0 || this->_stream.input_ended())){
+        return false;
+    }
+    if (2 * size >= this->_max_window){
+        return false;
+    }
+    return this->_sws_wait < TCPConfig::SWS_OVERRIDE_TIMEOUT;
+}
+
+//! \param[in] limit longest, in milliseconds, that data may be held back (TCP_CORK in Linux holds it 200 ms)
+void TCPSender::cork(const size_t limit) {
+    this->_corked = true;
+    this->_cork_limit = limit;
+}
+
+void TCPSender::uncork() {
+    this->_corked = false;
+    this->_corked_for = 0;
 }
 
 //! \param ackno The remote receiver's ackno (acknowledgment number)
@@ -65,6 +144,13 @@ void TCPSender::ack_received(const WrappingInt32 ackno, const uint16_t window_si
         this->_timer.reset(temp, this->_isn);
 
         this->_first_notaccept = this->_first_unackno + window_size;
+        this->_max_window = max<uint64_t>(this->_max_window, window_size);
+
+        // the probe got through, so the path carries segments that big
+        if (this->_probe.has_value() && temp >= this->_probe->first + this->_probe->second){
+            this->_pkg_size = this->_probe->second;
+            this->_probe.reset();
+        }
     }
 }
 
@@ -74,32 +160,66 @@ void TCPSender::tick(const size_t ms_since_last_tick) {
     if (state == TCPSenderStateSummary::CLOSED || 
     state == TCPSenderStateSummary::ERROR) return;
 
+    if (this->_corked && this->_stream.buffer_size() > 0){
+        this->_corked_for += ms_since_last_tick;
+    }
+    if (this->_sws_holding){
+        this->_sws_wait += ms_since_last_tick;
+    }
+
+    bool retransmitted;
     if (this->_first_notaccept == this->_first_unackno){
-        this->_timer.prone(this->_segments_out, ms_since_last_tick);
+        retransmitted = this->_timer.prone(this->_segments_out, ms_since_last_tick, this->_pkg_size);
     }else{
-        this->_timer.timerTick(this->_segments_out, ms_since_last_tick);
+        retransmitted = this->_timer.timerTick(this->_segments_out, ms_since_last_tick, this->_pkg_size);
     }
+
+    // a lost probe is taken to mean it was too big: try halfway to the current size next time.
+    // (the timer has already split it, so its data goes again in segments of the current size)
+    // it says nothing about congestion (RFC 4821), so the timer doesn't back off or count it.
+    if (retransmitted && this->_probe.has_value() &&
+        this->_timer.front().header().seqno == wrap(this->_probe->first, this->_isn)){
+        this->_probe_limit = this->_pkg_size + (this->_probe->second - this->_pkg_size) / 2;
+        this->_timer.probeLost(this->_segments_out, this->_probe->first + this->_probe->second, this->_isn);
+        this->_probe.reset();
+    }
+}
+
+//! \param[in] max_payload the largest payload that fits the path, e.g. from an ICMP "fragmentation needed"
+//! \details Only ever lowers the MSS (to no less than TCPConfig::MIN_PAYLOAD_SIZE), and stops probing, since
+//! the network has said what fits. Segments in flight that are too big are split, and the oldest of them is
+//! resent now.
+void TCPSender::max_payload_reported(const size_t max_payload) {
+    const uint64_t size = max<uint64_t>(max_payload, TCPConfig::MIN_PAYLOAD_SIZE);
+    if (size >= this->_pkg_size){
+        return;
+    }
+
+    this->_pkg_size = size;
+    this->_probe_limit = size;
+    this->_probe.reset();
+    this->_timer.resegment(this->_segments_out, this->_pkg_size);
 }
 
 void TCPSender::_send_syn() {
     TCPSegment seg;
     seg.header().syn = true;
     seg.header().seqno = this->_isn;
-    this->_segments_out.push(seg);
 
     this->_next_seqno ++;
     this->_timer.push(seg);
+    this->_segments_out.push(move(seg));
 }
 
 void TCPSender::send_empty_segment() {
     TCPSegment seg;
     seg.header().seqno = this->next_seqno();
-    this->_segments_out.push(seg);
+    this->_segments_out.push(move(seg));
 }
 
-void TCPSender::send_package(string &&payload, uint64_t &start){
+void TCPSender::send_package(Buffer &&payload, uint64_t &start){
     TCPSegment seg;
-    seg.payload() = Buffer(move(payload));
+    seg.payload() = move(payload);
     seg.header().seqno = wrap(start, this->_isn);
     uint64_t last = start + seg.payload().size();
 
@@ -118,54 +238,120 @@ void TCPSender::send_package(string &&payload, uint64_t &start){
         this->_next_seqno = last;
     }
 
-    this->_segments_out.push(seg);
+    // sum the payload once, so the copy kept for retransmission doesn't redo it
+    seg.payload_cksum();
+
     this->_timer.push(seg);
+    this->_segments_out.push(move(seg));
 }
 
 RetransTimer::RetransTimer(const unsigned int retx_timeout):
 _initial_retransmission_timeout(retx_timeout){
 }
 
-void RetransTimer::push(TCPSegment &seg){
-    this->_waiting_segs.push(TCPSegment(seg));
+void RetransTimer::push(const TCPSegment &seg){
+    if (!this->_waiting_segs){
+        this->_waiting_segs = make_unique<deque<TCPSegment>>();
+    }
+    this->_waiting_segs->push_back(seg);
 }
 
-void RetransTimer::timerTick(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick){
-    if (this->_waiting_segs.size() == 0) return;
+bool RetransTimer::timerTick(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick, size_t max_payload){
+    if (!this->_waiting()) return false;
 
     this->_tick_accum += ms_since_last_tick;
     if (this->_tick_accum >= (this->_initial_retransmission_timeout) * pow(2, this->_retransCounter)){
         this->_tick_accum = 0;
         this->_retransCounter ++;
-        
-        segments_out.push(TCPSegment(this->_waiting_segs.front()));
+
+        this->_split_front(max_payload);
+        segments_out.push(this->_waiting_segs->front());
+        return true;
     }
+    return false;
 }
 
-void RetransTimer::prone(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick){
-    if (this->_waiting_segs.size() == 0) return;
+bool RetransTimer::prone(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick, size_t max_payload){
+    if (!this->_waiting()) return false;
 
     this->_tick_accum += ms_since_last_tick;
     if (this->_tick_accum >= this->_initial_retransmission_timeout){
         this->_tick_accum = 0;
         this->_retransCounter ++;
-        
-        segments_out.push(TCPSegment(this->_waiting_segs.front()));
+
+        this->_split_front(max_payload);
+        segments_out.push(this->_waiting_segs->front());
+        return true;
+    }
+    return false;
+}
+
+void RetransTimer::resegment(std::queue<TCPSegment> &segments_out, size_t max_payload){
+    if (!this->_waiting()) return;
+
+    // put them back newest first, splitting each as it becomes the front,
+    // and remember how many go in front of the oldest one split
+    deque<TCPSegment> unsplit;
+    swap(unsplit, *this->_waiting_segs);
+    optional<size_t> oldest_split;
+    while (!unsplit.empty()){
+        this->_waiting_segs->push_front(move(unsplit.back()));
+        unsplit.pop_back();
+        if (this->_split_front(max_payload)){
+            oldest_split = unsplit.size();
+        }
+    }
+
+    // only a segment that was too big is known to be lost
+    if (oldest_split.has_value()){
+        segments_out.push((*this->_waiting_segs)[*oldest_split]);
     }
 }
 
+void RetransTimer::probeLost(std::queue<TCPSegment> &segments_out, uint64_t probe_end, const WrappingInt32 &isn){
+    this->_retransCounter --;
+
+    // the front went out already; the rest of the probe's data follows it
+    for (auto it = next(this->_waiting_segs->begin()); it != this->_waiting_segs->end(); it++){
+        if (unwrap(it->header().seqno, isn, probe_end) >= probe_end) break;
+        segments_out.push(*it);
+    }
+}
+
+bool RetransTimer::_split_front(size_t max_payload){
+    if (this->_waiting_segs->front().payload().size() <= max_payload) return false;
+
+    const TCPSegment whole = move(this->_waiting_segs->front());
+    this->_waiting_segs->pop_front();
+
+    const string payload = whole.payload().copy();
+    vector<TCPSegment> pieces;
+    for (size_t start = 0; start < payload.size(); start += max_payload){
+        TCPSegment piece;
+        piece.header() = whole.header();
+        piece.header().seqno = whole.header().seqno + start;
+        piece.header().fin = whole.header().fin && start + max_payload >= payload.size();
+        piece.payload() = Buffer(payload.substr(start, max_payload));
+        pieces.push_back(move(piece));
+    }
+    for (auto it = pieces.rbegin(); it != pieces.rend(); it++){
+        this->_waiting_segs->push_front(move(*it));
+    }
+    return true;
+}
+
 void RetransTimer::reset(uint64_t ackno, const WrappingInt32 &isn){
     bool isReset = false;
 
     while (true){
-        if (this->_waiting_segs.size() == 0) break;
+        if (!this->_waiting()) break;
 
-        uint64_t startno = unwrap(this->_waiting_segs.front().header().seqno, isn, ackno);
+        uint64_t startno = unwrap(this->_waiting_segs->front().header().seqno, isn, ackno);
         if (startno + 
-            this->_waiting_segs.front().payload().size() + 
-            this->_waiting_segs.front().header().fin <= ackno){
+            this->_waiting_segs->front().payload().size() + 
+            this->_waiting_segs->front().header().fin <= ackno){
 
-            this->_waiting_segs.pop();
+            this->_waiting_segs->pop_front();
 
             isReset = true;
         }else{
@@ -177,4 +363,7 @@ void RetransTimer::reset(uint64_t ackno, const WrappingInt32 &isn){
         this->_retransCounter = 0;
         this->_tick_accum = 0;
     }
+    if (!this->_waiting()){
+        this->_waiting_segs.reset();
+    }
 }
\ No newline at end of file
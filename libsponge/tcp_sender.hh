@@ -6,8 +6,12 @@
 #include "tcp_segment.hh"
 #include "wrapping_integers.hh"
 
+#include <deque>
 #include <functional>
+#include <memory>
+#include <optional>
 #include <queue>
+#include <utility>
 
 // the internal class of TCPsender, doing the job of resend seg after timeout.
 class RetransTimer {
@@ -18,20 +22,38 @@ class RetransTimer {
   
   uint64_t _tick_accum{0};
 
-  std::queue<TCPSegment> _waiting_segs{std::queue<TCPSegment>()};
+  // allocated on the first push and freed once everything is acknowledged, so an idle sender holds none
+  std::unique_ptr<std::deque<TCPSegment>> _waiting_segs{};
+
+  bool _waiting() const { return this->_waiting_segs && !this->_waiting_segs->empty(); }
+
+  // split the oldest waiting segment into ones carrying at most `max_payload` bytes each, if it's bigger
+  bool _split_front(size_t max_payload);
 
   public:
   
   RetransTimer(const unsigned int retx_timeout);
 
-  void push(TCPSegment &seg);
+  // keeps a copy for retransmission; the copy shares the payload with `seg`
+  void push(const TCPSegment &seg);
 
-  void timerTick(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick);
+  // both return whether the oldest segment was retransmitted, split first if it's over `max_payload`
+  bool timerTick(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick, size_t max_payload);
 
-  void prone(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick);
+  bool prone(std::queue<TCPSegment> &segments_out, size_t ms_since_last_tick, size_t max_payload);
 
   void reset(uint64_t ackno, const WrappingInt32 &isn);
 
+  // split every waiting segment over `max_payload`, then retransmit the oldest of those right away
+  void resegment(std::queue<TCPSegment> &segments_out, size_t max_payload);
+
+  // the oldest segment was a probe that just timed out: take back the backoff and the attempt,
+  // and retransmit the rest of its data (the pieces before `probe_end`) along with it
+  void probeLost(std::queue<TCPSegment> &segments_out, uint64_t probe_end, const WrappingInt32 &isn);
+
+  // the oldest waiting segment
+  const TCPSegment &front() const { return this->_waiting_segs->front(); }
+
   unsigned int consecutive_retransmissions() const { return this->_retransCounter; }
 };
 
@@ -67,12 +89,47 @@ class TCPSender {
     //! fin number
     bool _finsent{false};
 
-    //! size of one package
-    const uint64_t _pkg_size{TCPConfig::MAX_PAYLOAD_SIZE};
+    //! size of one package: the effective MSS, raised by successful probes and lowered by the network
+    uint64_t _pkg_size;
+
+    //! largest package a probe may try; each lost probe halves its distance to `_pkg_size`
+    uint64_t _probe_limit;
+
+    //! the probe in flight, if any: its first sequence number and its size
+    std::optional<std::pair<uint64_t, uint64_t>> _probe{};
+
+    //! a probe must be at least this much larger than `_pkg_size` to be worth sending
+    static constexpr uint64_t _min_probe_gain{32};
+
+    //! Nagle's algorithm (RFC 896): hold back a short segment while earlier data is unacknowledged
+    bool _nagle{false};
+
+    //! corked: hold back a short segment until uncorked, or for at most `_cork_limit` milliseconds
+    bool _corked{false};
+    uint64_t _cork_limit{0};
+
+    //! milliseconds that data has been held back by the cork
+    uint64_t _corked_for{0};
+
+    //! should the remaining data, shorter than a package, wait for more?
+    bool _hold_short() const;
+
+    //! silly window syndrome avoidance (RFC 1122 4.2.3.4): don't send a small segment into a small window
+    bool _sws_avoidance{false};
+
+    //! the largest window the receiver has offered
+    uint64_t _max_window{0};
+
+    //! is a segment being held back to avoid a silly window, and for how many milliseconds?
+    bool _sws_holding{false};
+    uint64_t _sws_wait{0};
+
+    //! should a segment of `size` bytes, short of a package, wait for the window to open further?
+    bool _sws_hold(const uint64_t size) const;
 
     RetransTimer _timer;
 
-    void send_package(std::string &&payload, uint64_t &start);
+    void send_package(Buffer &&payload, uint64_t &start);
 
     void _send_syn();
 
@@ -80,7 +137,9 @@ class TCPSender {
     //! Initialize a TCPSender
     TCPSender(const size_t capacity = TCPConfig::DEFAULT_CAPACITY,
               const uint16_t retx_timeout = TCPConfig::TIMEOUT_DFLT,
-              const std::optional<WrappingInt32> fixed_isn = {});
+              const std::optional<WrappingInt32> fixed_isn = {},
+              const size_t mss = TCPConfig::MAX_PAYLOAD_SIZE,
+              const size_t mss_probe_limit = TCPConfig::MAX_PAYLOAD_SIZE);
 
     //! \name "Input" interface for the writer
     //!@{
@@ -102,6 +161,27 @@ class TCPSender {
 
     //! \brief Notifies the TCPSender of the passage of time
     void tick(const size_t ms_since_last_tick);
+
+    //! \brief The network reported that segments with more than `max_payload` bytes don't fit the path
+    void max_payload_reported(const size_t max_payload);
+    //!@}
+
+    //! \name Coalescing small writes
+    //!@{
+
+    //! \brief Turn Nagle's algorithm on or off
+    void set_nagle(const bool nagle) { _nagle = nagle; }
+
+    //! \brief Turn silly window syndrome avoidance on or off
+    void set_sws_avoidance(const bool sws_avoidance) { _sws_avoidance = sws_avoidance; }
+
+    //! \brief Hold back short segments until uncork(), or for at most `limit` milliseconds
+    void cork(const size_t limit);
+
+    //! \brief Stop holding back short segments (fill_window() then sends what was held)
+    void uncork();
+
+    bool corked() const { return _corked; }
     //!@}
 
     //! \name Accessors
@@ -112,6 +192,9 @@ class TCPSender {
     //! (see TCPSegment::length_in_sequence_space())
     size_t bytes_in_flight() const;
 
+    //! \brief Largest payload the TCPSender puts in a segment (the effective MSS)
+    size_t max_payload_size() const { return _pkg_size; }
+
     //! \brief Number of consecutive retransmissions that have occurred in a row
     unsigned int consecutive_retransmissions() const { return this->_timer.consecutive_retransmissions(); };
 
@@ -1,15 +1,261 @@
 #include "buffer.hh"
 
+#include <cstring>
+#include <new>
+
 using namespace std;
 
+namespace {
+
+//! The free slabs and statistics of one thread
+struct PoolState {
+    array<vector<BufferPool::Slab *>, BufferPool::SLAB_CLASSES> free_slabs{};
+    vector<BufferList *> free_lists{};
+    BufferPool::Stats stats{};
+
+    PoolState() = default;
+    PoolState(const PoolState &other) = delete;
+    PoolState &operator=(const PoolState &other) = delete;
+    ~PoolState();
+};
+
+thread_local PoolState pool_state{};
+
+//! Set once the thread's pool has been destroyed, for Buffers that outlive it (e.g., in static objects)
+thread_local bool pool_destroyed = false;
+
+//! Bytes of headroom in a slab of class `size_class`
+size_t headroom_of(const size_t size_class) {
+    return size_class + 1 == BufferPool::SLAB_CLASSES ? BufferPool::HEADROOM : 0;
+}
+
+BufferPool::Slab *new_slab(const size_t size_class) {
+    auto *slab = new (::operator new(sizeof(BufferPool::Slab) + BufferPool::SLAB_SIZES[size_class])) BufferPool::Slab;
+    slab->size_class = size_class;
+    return slab;
+}
+
+void delete_slab(BufferPool::Slab *slab) {
+    slab->~Slab();
+    ::operator delete(slab);
+}
+
+PoolState::~PoolState() {
+    for (auto &slabs : free_slabs) {
+        for (auto *slab : slabs) {
+            delete_slab(slab);
+        }
+    }
+    for (auto *list : free_lists) {
+        delete list;
+    }
+    pool_destroyed = true;
+}
+
+}  // namespace
+
+BufferPool::Slab *BufferPool::acquire(const size_t len) {
+    size_t size_class = 0;
+    while (size_class < SLAB_CLASSES and len + headroom_of(size_class) > SLAB_SIZES[size_class]) {
+        size_class++;
+    }
+    if (size_class == SLAB_CLASSES) {
+        if (not pool_destroyed) {
+            pool_state.stats.oversized++;
+        }
+        return nullptr;
+    }
+
+    Slab *slab = nullptr;
+    if (pool_destroyed or pool_state.free_slabs[size_class].empty()) {
+        if (not pool_destroyed) {
+            pool_state.stats.misses++;
+        }
+        slab = new_slab(size_class);
+    } else {
+        pool_state.stats.hits++;
+        slab = pool_state.free_slabs[size_class].back();
+        pool_state.free_slabs[size_class].pop_back();
+        slab->refcount = 1;
+    }
+    slab->begin = slab->end = headroom_of(size_class);
+    return slab;
+}
+
+void BufferPool::release(Slab *slab) {
+    if (--slab->refcount > 0) {
+        return;
+    }
+
+    if (pool_destroyed or pool_state.free_slabs[slab->size_class].size() >= MAX_FREE_SLABS) {
+        delete_slab(slab);
+        return;
+    }
+
+    pool_state.free_slabs[slab->size_class].push_back(slab);
+}
+
+BufferList *BufferPool::acquire_list() {
+    if (pool_destroyed or pool_state.free_lists.empty()) {
+        if (not pool_destroyed) {
+            pool_state.stats.list_misses++;
+        }
+        return new BufferList;
+    }
+
+    pool_state.stats.list_hits++;
+    BufferList *list = pool_state.free_lists.back();
+    pool_state.free_lists.pop_back();
+    return list;
+}
+
+void BufferPool::release_list(BufferList *list) {
+    if (pool_destroyed or pool_state.free_lists.size() >= MAX_FREE_LISTS) {
+        delete list;
+        return;
+    }
+
+    list->clear();
+    pool_state.free_lists.push_back(list);
+}
+
+size_t BufferPool::free_lists() { return pool_destroyed ? 0 : pool_state.free_lists.size(); }
+
+const BufferPool::Stats &BufferPool::stats() { return pool_state.stats; }
+
+//! \details Contents that fit in a slab are copied into it and `str` is freed; otherwise the string
+//! itself is kept, as it's cheaper to adopt its allocation than to copy it.
+Buffer::Buffer(string &&str) {
+    if (not str.empty() and not _store_in_slab(str)) {
+        _storage = make_shared<string>(move(str));
+    }
+}
+
+Buffer::Buffer(const string_view str) {
+    if (not str.empty() and not _store_in_slab(str)) {
+        _storage = make_shared<string>(str);
+    }
+}
+
+//! \details The bytes are copied once, straight into a slab if they fit, or else into a std::string.
+Buffer::Buffer(const BufferList &list, const size_t len) {
+    if (len > list.size()) {
+        throw out_of_range("Buffer: BufferList is shorter than len");
+    }
+    if (len == 0) {
+        return;
+    }
+
+    char *dest = nullptr;
+    _slab = BufferPool::acquire(len);
+    if (_slab) {
+        dest = _slab->bytes() + _slab->begin;
+        _slab->end = _slab->begin + len;
+    } else {
+        _storage = make_shared<string>(len, '\0');
+        dest = _storage->data();
+    }
+
+    size_t left = len;
+    for (auto it = list.buffers().begin(); left > 0; it++) {
+        const size_t n = min(left, it->size());
+        memcpy(dest, it->str().data(), n);
+        dest += n;
+        left -= n;
+    }
+}
+
+bool Buffer::_store_in_slab(const string_view str) {
+    _slab = BufferPool::acquire(str.size());
+    if (not _slab) {
+        return false;
+    }
+    memcpy(_slab->bytes() + _slab->begin, str.data(), str.size());
+    _slab->end = _slab->begin + str.size();
+    return true;
+}
+
+Buffer::Buffer(const Buffer &other)
+    : _slab(other._slab), _storage(other._storage), _starting_offset(other._starting_offset) {
+    if (_slab) {
+        _slab->refcount++;
+    }
+}
+
+Buffer::Buffer(Buffer &&other) noexcept
+    : _slab(other._slab), _storage(move(other._storage)), _starting_offset(other._starting_offset) {
+    other._slab = nullptr;
+    other._starting_offset = 0;
+}
+
+Buffer &Buffer::operator=(const Buffer &other) {
+    if (this != &other) {
+        if (other._slab) {
+            other._slab->refcount++;
+        }
+        _reset();
+        _slab = other._slab;
+        _storage = other._storage;
+        _starting_offset = other._starting_offset;
+    }
+    return *this;
+}
+
+Buffer &Buffer::operator=(Buffer &&other) noexcept {
+    if (this != &other) {
+        _reset();
+        _slab = other._slab;
+        _storage = move(other._storage);
+        _starting_offset = other._starting_offset;
+        other._slab = nullptr;
+        other._starting_offset = 0;
+    }
+    return *this;
+}
+
+void Buffer::_reset() {
+    if (_slab) {
+        BufferPool::release(_slab);
+        _slab = nullptr;
+    }
+    _storage.reset();
+    _starting_offset = 0;
+}
+
 void Buffer::remove_prefix(const size_t n) {
     if (n > str().size()) {
         throw out_of_range("Buffer::remove_prefix");
     }
     _starting_offset += n;
-    if (_storage and _starting_offset == _storage->size()) {
-        _storage.reset();
+    if (str().empty()) {
+        _reset();
+    }
+}
+
+size_t Buffer::headroom() const {
+    if (not _slab or _slab->refcount > 1) {
+        return 0;
+    }
+    return _slab->begin + _starting_offset;
+}
+
+void Buffer::prepend(const string_view prefix) {
+    if (prefix.size() > headroom()) {
+        throw out_of_range("Buffer::prepend");
+    }
+    _slab->begin += _starting_offset;
+    _starting_offset = 0;
+    _slab->begin -= prefix.size();
+    memcpy(_slab->bytes() + _slab->begin, prefix.data(), prefix.size());
+}
+
+bool Buffer::extend(const string_view suffix) {
+    if (not _slab or _slab->refcount > 1 or suffix.size() > _slab->capacity() - _slab->end) {
+        return false;
     }
+    memcpy(_slab->bytes() + _slab->end, suffix.data(), suffix.size());
+    _slab->end += suffix.size();
+    return true;
 }
 
 void BufferList::append(const BufferList &other) {
@@ -18,6 +264,13 @@ void BufferList::append(const BufferList &other) {
     }
 }
 
+void BufferList::append_copy(const string_view str) {
+    if (str.empty() or (not _buffers.empty() and _buffers.back().extend(str))) {
+        return;
+    }
+    _buffers.emplace_back(str);
+}
+
 BufferList::operator Buffer() const {
     switch (_buffers.size()) {
         case 0:
@@ -102,3 +355,11 @@ vector<iovec> BufferViewList::as_iovecs() const {
     }
     return ret;
 }
+
+uint8_t *Headroom::prepend(const size_t n) {
+    if (n > _start) {
+        throw out_of_range("Headroom::prepend");
+    }
+    _start -= n;
+    return _bytes.data() + _start;
+}
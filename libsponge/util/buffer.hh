@@ -2,6 +2,8 @@
 #define SPONGE_LIBSPONGE_BUFFER_HH
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <deque>
 #include <memory>
 #include <numeric>
@@ -11,21 +13,117 @@
 #include <sys/uio.h>
 #include <vector>
 
+class BufferList;
+
+//! \brief A per-thread pool of slabs, in a few size classes, that back packet-sized Buffers
+//! \details A slab carries its own reference count, which is not atomic: a Buffer (and its copies) may be
+//! handed to another thread, but must not be copied or destroyed concurrently from two threads. A slab
+//! released on a thread other than the one that allocated it joins the releasing thread's pool.
+//!
+//! Contents go in the smallest size class they fit, so a small Buffer doesn't pin a packet-sized slab. Only the
+//! largest class keeps headroom, since that's where packet payloads go.
+//!
+//! The pool also keeps empty BufferLists, with the memory their queue of Buffers held, for storage that comes
+//! and goes (a ByteStream takes one on its first write and gives it back once it has been drained).
+class BufferPool {
+  public:
+    //! Bytes in a slab of each size class
+    static constexpr std::array<size_t, 3> SLAB_SIZES{64, 256, 2048};
+    static constexpr size_t SLAB_CLASSES = SLAB_SIZES.size();           //!< Number of size classes
+    static constexpr size_t SLAB_SIZE = SLAB_SIZES[SLAB_CLASSES - 1];  //!< Bytes in a slab of the largest class
+    static constexpr size_t HEADROOM = 128;  //!< Bytes kept free in front of the contents, in the largest class
+    static constexpr size_t MAX_FREE_SLABS = 1024;  //!< Free slabs of a class beyond this many go back to the heap
+    static constexpr size_t MAX_FREE_LISTS = 1024;  //!< Free BufferLists beyond this many go back to the heap
+
+    //! \brief Storage for one Buffer and its copies: this header, followed by the slab's bytes
+    struct Slab {
+        size_t refcount{1};   //!< Buffers referring to this slab
+        size_t begin{};       //!< Index of the first byte of the contents
+        size_t end{};         //!< Index one past the last byte of the contents
+        size_t size_class{};  //!< Index into SLAB_SIZES
+
+        //! The slab's bytes: headroom, then the contents, then room to append
+        char *bytes() { return reinterpret_cast<char *>(this + 1); }
+        const char *bytes() const { return reinterpret_cast<const char *>(this + 1); }
+
+        //! Number of bytes in the slab
+        size_t capacity() const { return SLAB_SIZES[size_class]; }
+    };
+
+    //! \brief Allocation statistics for the calling thread's pool
+    struct Stats {
+        uint64_t hits{};         //!< Slabs reused from the pool
+        uint64_t misses{};       //!< Slabs that had to be allocated from the heap
+        uint64_t oversized{};    //!< Buffers too big for a slab, stored in a std::string instead
+        uint64_t list_hits{};    //!< BufferLists reused from the pool
+        uint64_t list_misses{};  //!< BufferLists that had to be allocated from the heap
+    };
+
+    //! \brief Get a slab of the smallest class with room for `len` bytes after its headroom
+    //! \returns nullptr if `len` doesn't fit in a slab
+    static Slab *acquire(const size_t len);
+
+    //! \brief Drop one reference to `slab`, returning it to the pool when it was the last
+    static void release(Slab *slab);
+
+    //! \brief Get an empty BufferList
+    static BufferList *acquire_list();
+
+    //! \brief Empty `list` and return it to the pool
+    static void release_list(BufferList *list);
+
+    //! \brief How many BufferLists the calling thread's pool has free
+    static size_t free_lists();
+
+    //! \brief The calling thread's statistics
+    static const Stats &stats();
+};
+
 //! \brief A reference-counted read-only string that can discard bytes from the front
+//! \details Contents that fit in a BufferPool slab are copied into one; larger contents are kept in a
+//! std::string owned through a std::shared_ptr.
 class Buffer {
   private:
+    BufferPool::Slab *_slab{};
     std::shared_ptr<std::string> _storage{};
     size_t _starting_offset{};
 
+    //! Copy `str` into a slab if it fits, otherwise return false
+    bool _store_in_slab(const std::string_view str);
+
+    //! Drop this Buffer's reference to its storage
+    void _reset();
+
   public:
     Buffer() = default;
 
     //! \brief Construct by taking ownership of a string
-    Buffer(std::string &&str) noexcept : _storage(std::make_shared<std::string>(std::move(str))) {}
+    Buffer(std::string &&str);
+
+    //! \brief Construct by copying from a string_view
+    explicit Buffer(const std::string_view str);
+
+    //! \brief Construct by copying the first `len` bytes of `list`, without concatenating them first
+    Buffer(const BufferList &list, const size_t len);
+
+    //! \name Copy/move constructor/assignment operators
+    //! Copies share the underlying storage
+    //!@{
+    Buffer(const Buffer &other);
+    Buffer(Buffer &&other) noexcept;
+    Buffer &operator=(const Buffer &other);
+    Buffer &operator=(Buffer &&other) noexcept;
+    //!@}
+
+    ~Buffer() { _reset(); }
 
     //! \name Expose contents as a std::string_view
     //!@{
     std::string_view str() const {
+        if (_slab) {
+            return {_slab->bytes() + _slab->begin + _starting_offset,
+                    _slab->end - _slab->begin - _starting_offset};
+        }
         if (not _storage) {
             return {};
         }
@@ -47,6 +145,17 @@ class Buffer {
     //! \brief Discard the first `n` bytes of the string (does not require a copy or move)
     //! \note Doesn't free any memory until the whole string has been discarded in all copies of the Buffer.
     void remove_prefix(const size_t n);
+
+    //! \brief Bytes that can be prepended in place (nonzero only if no other Buffer shares the storage)
+    size_t headroom() const;
+
+    //! \brief Put `prefix` in front of the contents, in place
+    //! \note Throws unless `prefix.size() <= headroom()`
+    void prepend(const std::string_view prefix);
+
+    //! \brief Append `suffix` to the contents in place, if no other Buffer shares the slab and it has room
+    //! \returns false (leaving the Buffer as it was) otherwise
+    bool extend(const std::string_view suffix);
 };
 
 //! \brief A reference-counted discontiguous string that can discard bytes from the front
@@ -68,7 +177,7 @@ class BufferList {
     BufferList(Buffer buffer) : _buffers{buffer} {}
 
     //! \brief Construct by taking ownership of a std::string
-    BufferList(std::string &&str) noexcept {
+    BufferList(std::string &&str) {
         Buffer buf{std::move(str)};
         append(buf);
     }
@@ -80,6 +189,13 @@ class BufferList {
     //! \brief Append a BufferList
     void append(const BufferList &other);
 
+    //! \brief Append a Buffer (without building a BufferList around it first)
+    void push_back(Buffer buffer) { _buffers.push_back(std::move(buffer)); }
+
+    //! \brief Append a copy of `str`, into the last Buffer's slab if it has room, so that many small appends
+    //! share slabs rather than taking one each
+    void append_copy(const std::string_view str);
+
     //! \brief Transform to a Buffer
     //! \note Throws an exception unless BufferList is contiguous
     operator Buffer() const;
@@ -92,6 +208,9 @@ class BufferList {
 
     //! \brief Make a copy to a new std::string
     std::string concatenate() const;
+
+    //! \brief Discard the whole string (keeping the memory that holds the queue of Buffers)
+    void clear() { _buffers.clear(); }
 };
 
 //! \brief A non-owning temporary view (similar to std::string_view) of a discontiguous string
@@ -127,4 +246,34 @@ class BufferViewList {
     std::vector<iovec> as_iovecs() const;
 };
 
+//! \brief Fixed-size scratch space that packet headers are prepended into, back to front
+//! \details Serializing a TCP header, then the IPv4 header in front of it, then the Ethernet
+//! header in front of that leaves all of them contiguous and ready to be written, together
+//! with the (uncopied) payload, by a single [writev(2)](\ref man2::writev). No heap allocation is involved.
+class Headroom {
+  public:
+    //! Room for Ethernet (14 bytes), IPv4 (up to 60 bytes) and TCP (up to 60 bytes) headers
+    static constexpr size_t CAPACITY = 136;
+
+  private:
+    std::array<uint8_t, CAPACITY> _bytes{};
+    size_t _start{CAPACITY};  //!< index of the first byte that has been written
+
+  public:
+    //! \brief Reserve `n` bytes in front of everything written so far
+    //! \returns a pointer to the reserved bytes, which the caller fills in
+    uint8_t *prepend(const size_t n);
+
+    //! \brief The bytes written so far
+    std::string_view str() const {
+        return {reinterpret_cast<const char *>(_bytes.data()) + _start, CAPACITY - _start};
+    }
+
+    //! \brief Number of bytes written so far
+    size_t size() const { return CAPACITY - _start; }
+
+    //! \brief Discard everything written, e.g. before serializing the next packet
+    void clear() { _start = CAPACITY; }
+};
+
 #endif  // SPONGE_LIBSPONGE_BUFFER_HH
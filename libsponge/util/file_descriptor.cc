@@ -3,6 +3,7 @@
 #include "util.hh"
 
 #include <algorithm>
+#include <array>
 #include <fcntl.h>
 #include <iostream>
 #include <stdexcept>
@@ -98,6 +99,48 @@ size_t FileDescriptor::write(BufferViewList buffer, const bool write_all) {
     return total_bytes_written;
 }
 
+//! \details Meant for packet-oriented file descriptors (e.g. TUN/TAP devices), where each write is
+//! exactly one packet and is never partially completed. Unlike write(), nothing is allocated on the heap.
+size_t FileDescriptor::write_packet(const string_view header, const string_view payload) {
+    const array<iovec, 2> iovecs{{{const_cast<char *>(header.data()), header.size()},
+                                  {const_cast<char *>(payload.data()), payload.size()}}};
+    return _write_packet(iovecs.data(), iovecs.size());
+}
+
+//! \details The payload's buffers are referenced, not copied, unless there are more than
+//! MAX_PACKET_IOVECS of them.
+size_t FileDescriptor::write_packet(const string_view header, const BufferList &payload) {
+    if (payload.buffers().size() >= MAX_PACKET_IOVECS) {
+        const string contiguous = payload.concatenate();
+        return write_packet(header, string_view(contiguous));
+    }
+
+    array<iovec, MAX_PACKET_IOVECS> iovecs{};
+    size_t count = 0;
+    iovecs[count++] = {const_cast<char *>(header.data()), header.size()};
+    for (const auto &buf : payload.buffers()) {
+        const string_view view = buf;
+        iovecs[count++] = {const_cast<char *>(view.data()), view.size()};
+    }
+    return _write_packet(iovecs.data(), count);
+}
+
+size_t FileDescriptor::_write_packet(const iovec *iovecs, const size_t count) {
+    size_t total_size = 0;
+    for (size_t i = 0; i < count; i++) {
+        total_size += iovecs[i].iov_len;
+    }
+
+    const ssize_t bytes_written = SystemCall("writev", ::writev(fd_num(), iovecs, count));
+    register_write();
+
+    if (size_t(bytes_written) != total_size) {
+        throw runtime_error("writev wrote a partial packet");
+    }
+
+    return bytes_written;
+}
+
 void FileDescriptor::set_blocking(const bool blocking_state) {
     int flags = SystemCall("fcntl", fcntl(fd_num(), F_GETFL));
     if (blocking_state) {
@@ -44,6 +44,12 @@ class FileDescriptor {
     // private constructor used to duplicate the FileDescriptor (increase the reference count)
     explicit FileDescriptor(std::shared_ptr<FDWrapper> other_shared_ptr);
 
+    //! Gather `count` buffers into one packet and write it with a single call to [writev(2)](\ref man2::writev)
+    size_t _write_packet(const iovec *iovecs, const size_t count);
+
+    //! Most buffers write_packet() will gather without copying the payload
+    static constexpr size_t MAX_PACKET_IOVECS = 16;
+
   protected:
     void register_read() { ++_internal_fd->_read_count; }    //!< increment read count
     void register_write() { ++_internal_fd->_write_count; }  //!< increment write count
@@ -70,6 +76,12 @@ class FileDescriptor {
     //! Write a buffer (or list of buffers), possibly blocking until all is written
     size_t write(BufferViewList buffer, const bool write_all = true);
 
+    //! Write one packet (a header followed by a payload) with a single system call
+    size_t write_packet(const std::string_view header, const std::string_view payload);
+
+    //! Write one packet (a header followed by a discontiguous payload) with a single system call
+    size_t write_packet(const std::string_view header, const BufferList &payload);
+
     //! Close the underlying file descriptor
     void close() { _internal_fd->close(); }
 
@@ -5,6 +5,8 @@
 
 #include <cstdint>
 #include <cstdlib>
+#include <cstring>
+#include <endian.h>
 #include <string>
 #include <utility>
 
@@ -60,12 +62,40 @@ class NetParser {
 
     //! Remove n bytes from the buffer
     void remove_prefix(const size_t n);
+
+    //! \name Fixed-layout fast path
+    //! For headers whose leading fields sit at fixed offsets: peek() bounds-checks the whole fixed part once,
+    //! the load functions read fields at known offsets without further checks, and remove_prefix() consumes
+    //! the header (fixed part plus any options) in one step.
+    //!@{
+
+    //! \brief View the next `n` bytes without consuming them
+    //! \returns nullptr (and sets the error) if fewer than `n` bytes remain
+    const uint8_t *peek(const size_t n);
+
+    //! Load a 32-bit integer in network byte order from `p`
+    static uint32_t load_u32(const uint8_t *p) {
+        uint32_t val;
+        std::memcpy(&val, p, sizeof(val));
+        return be32toh(val);
+    }
+
+    //! Load a 16-bit integer in network byte order from `p`
+    static uint16_t load_u16(const uint8_t *p) {
+        uint16_t val;
+        std::memcpy(&val, p, sizeof(val));
+        return be16toh(val);
+    }
+    //!@}
 };
 
 struct NetUnparser {
     template <typename T>
     static void _unparse_int(std::string &s, T val);
 
+    template <typename T>
+    static void _unparse_int(uint8_t *&out, T val);
+
     //! Write a 32-bit integer into the data stream in network byte order
     static void u32(std::string &s, const uint32_t val);
 
@@ -74,6 +104,14 @@ struct NetUnparser {
 
     //! Write an 8-bit integer into the data stream in network byte order
     static void u8(std::string &s, const uint8_t val);
+
+    //! \name Write into preallocated memory
+    //! These write at `out` and advance it past the written bytes; the caller guarantees the space.
+    //!@{
+    static void u32(uint8_t *&out, const uint32_t val);
+    static void u16(uint8_t *&out, const uint16_t val);
+    static void u8(uint8_t *&out, const uint8_t val);
+    //!@}
 };
 
 #endif  // SPONGE_LIBSPONGE_PARSER_HH
@@ -0,0 +1,136 @@
+#ifndef SPONGE_LIBSPONGE_RING_HH
+#define SPONGE_LIBSPONGE_RING_HH
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+//! Size of a cache line, to keep the indices that different threads write from sharing one
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+//! Round `capacity` up to a power of two (at least 2)
+inline size_t ring_capacity(const size_t capacity) {
+    size_t rounded = 2;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+//! \brief A bounded, lock-free queue for exactly one producer thread and one consumer thread
+//! \details push() and pop() never block; push() fails when the ring is full, leaving the item with the caller.
+template <typename T>
+class SPSCRing {
+    const size_t _mask;
+    std::unique_ptr<T[]> _slots;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _head{0};  //!< Next slot to pop (written by the consumer)
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail{0};  //!< Next slot to push (written by the producer)
+
+  public:
+    //! Construct a ring holding at least `capacity` items
+    explicit SPSCRing(const size_t capacity)
+        : _mask(ring_capacity(capacity) - 1), _slots(std::make_unique<T[]>(_mask + 1)) {}
+
+    //! \brief Add an item (producer only)
+    //! \returns false, without moving from `item`, if the ring is full
+    bool push(T &&item) {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if (tail - _head.load(std::memory_order_acquire) > _mask) {
+            return false;
+        }
+        _slots[tail & _mask] = std::move(item);
+        _tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Remove the oldest item (consumer only), or return nothing if the ring is empty
+    std::optional<T> pop() {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return std::nullopt;
+        }
+        std::optional<T> item{std::move(_slots[head & _mask])};
+        _head.store(head + 1, std::memory_order_release);
+        return item;
+    }
+
+    //! Whether the ring is empty (consumer only)
+    bool empty() const { return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire); }
+
+    //! Number of items the ring can hold
+    size_t capacity() const { return _mask + 1; }
+};
+
+//! \brief A bounded, lock-free queue for any number of producer threads and one consumer thread
+//! \details Each slot carries a sequence number saying whether it is free for the producer that has claimed
+//! it or filled for the consumer (D. Vyukov's bounded queue), so producers only contend on claiming a slot.
+template <typename T>
+class MPSCRing {
+    struct Cell {
+        std::atomic<size_t> sequence{0};
+        T value{};
+    };
+
+    const size_t _mask;
+    std::unique_ptr<Cell[]> _cells;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> _tail{0};  //!< Next slot to claim (shared by the producers)
+    alignas(CACHE_LINE_SIZE) size_t _head{0};                //!< Next slot to pop (consumer only)
+
+  public:
+    //! Construct a ring holding at least `capacity` items
+    explicit MPSCRing(const size_t capacity)
+        : _mask(ring_capacity(capacity) - 1), _cells(std::make_unique<Cell[]>(_mask + 1)) {
+        for (size_t i = 0; i <= _mask; i++) {
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    //! \brief Add an item (any thread)
+    //! \returns false, without moving from `item`, if the ring is full
+    bool push(T &&item) {
+        size_t pos = _tail.load(std::memory_order_relaxed);
+        Cell *cell;
+        while (true) {
+            cell = &_cells[pos & _mask];
+            const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<std::intptr_t>(sequence - pos);
+            if (lag == 0) {
+                if (_tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (lag < 0) {
+                return false;  // the consumer hasn't freed this slot yet: full
+            } else {
+                pos = _tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(item);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //! \brief Remove the oldest item (consumer only), or return nothing if the ring is empty
+    std::optional<T> pop() {
+        Cell &cell = _cells[_head & _mask];
+        if (cell.sequence.load(std::memory_order_acquire) != _head + 1) {
+            return std::nullopt;
+        }
+        std::optional<T> item{std::move(cell.value)};
+        cell.sequence.store(_head + _mask + 1, std::memory_order_release);
+        _head++;
+        return item;
+    }
+
+    //! Whether the ring is empty (consumer only)
+    bool empty() const { return _cells[_head & _mask].sequence.load(std::memory_order_acquire) != _head + 1; }
+
+    //! Number of items the ring can hold
+    size_t capacity() const { return _mask + 1; }
+};
+
+#endif  // SPONGE_LIBSPONGE_RING_HH
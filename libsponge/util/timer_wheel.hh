@@ -0,0 +1,70 @@
+#ifndef SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+#define SPONGE_LIBSPONGE_TIMER_WHEEL_HH
+
+#include "ring.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+//! \brief A hashed timing wheel (Varghese and Lauck): many timers, with O(1) scheduling
+//! \details Time is cut into ticks of `granularity` ms, and a timer goes in the slot for the tick its deadline
+//! falls in, modulo the number of slots. Advancing the clock only visits the slots for the ticks that have
+//! passed, so its cost follows the timers that are due (and those that share their slots), not all of them.
+//! A timer can't be cancelled: the owner ignores the ones it no longer wants when they expire.
+template <typename T>
+class TimerWheel {
+    struct Timer {
+        T item;
+        uint64_t deadline;
+    };
+
+    const uint64_t _granularity;
+    const size_t _mask;
+    std::vector<std::vector<Timer>> _slots;
+    uint64_t _tick{0};  //!< The last tick whose slot has been visited
+    size_t _size{0};
+
+  public:
+    //! Construct a wheel of at least `slots` slots, each `granularity` ms (at least 1) wide
+    TimerWheel(const uint64_t granularity, const size_t slots)
+        : _granularity(granularity > 0 ? granularity : 1)
+        , _mask(ring_capacity(slots) - 1)
+        , _slots(_mask + 1) {}
+
+    //! \brief Have `item` expire once the clock reaches `deadline` (in ms)
+    void schedule(T item, const uint64_t deadline) {
+        // the first tick at or past the deadline, and never one that has been visited already
+        const uint64_t tick = std::max((deadline + _granularity - 1) / _granularity, _tick + 1);
+        _slots[tick & _mask].push_back({std::move(item), deadline});
+        _size++;
+    }
+
+    //! \brief Move the clock forward to `now` (in ms), appending the items that have expired to `expired`
+    void advance(const uint64_t now, std::vector<T> &expired) {
+        const uint64_t last = now / _granularity;
+        // a jump of a whole turn or more visits every slot just once
+        const uint64_t first = std::max(_tick + 1, last > _mask ? last - _mask : 0);
+        for (uint64_t tick = first; tick <= last; tick++) {
+            auto &slot = _slots[tick & _mask];
+            for (size_t i = 0; i < slot.size();) {
+                if (slot[i].deadline > now) {
+                    i++;  // due on a later turn of the wheel
+                    continue;
+                }
+                expired.push_back(std::move(slot[i].item));
+                slot[i] = std::move(slot.back());
+                slot.pop_back();
+                _size--;
+            }
+        }
+        _tick = std::max(_tick, last);
+    }
+
+    //! Number of timers scheduled (including any the owner no longer wants)
+    size_t size() const { return _size; }
+};
+
+#endif  // SPONGE_LIBSPONGE_TIMER_WHEEL_HH
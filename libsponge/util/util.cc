@@ -97,14 +97,29 @@ void InternetChecksum::add(std::string_view data) {
     }
 }
 
-uint16_t InternetChecksum::value() const {
+uint16_t InternetChecksum::value() const { return ~partial_sum(); }
+
+uint16_t InternetChecksum::partial_sum() const {
     uint32_t ret = _sum;
 
     while (ret > 0xffff) {
         ret = (ret >> 16) + (ret & 0xffff);
     }
 
-    return ~ret;
+    return ret;
+}
+
+//! \param[in] cksum is the checksum currently stored in the header (host byte order)
+//! \param[in] old_word is the previous value of the 16-bit word that changed
+//! \param[in] new_word is the new value of that word
+//! \returns the checksum that a full recomputation would produce
+//! \details Uses equation 3 of [RFC 1624](https://tools.ietf.org/html/rfc1624), `HC' = ~(~HC + ~m + m')`,
+//! which (unlike the RFC 1141 formula) never produces a "negative zero" the full computation wouldn't.
+//! This lets a router decrement the TTL, or a sender rewrite a port, in O(1) instead of
+//! re-summing the whole header or segment.
+uint16_t InternetChecksum::adjust16(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word) {
+    InternetChecksum check(uint16_t(~cksum) + uint16_t(~old_word) + uint32_t(new_word));
+    return check.value();
 }
 
 //! \param[in] data is a pointer to the bytes to show
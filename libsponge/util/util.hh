@@ -61,6 +61,12 @@ class InternetChecksum {
     InternetChecksum(const uint32_t initial_sum = 0);
     void add(std::string_view data);
     uint16_t value() const;
+
+    //! The running sum folded to 16 bits but not complemented (useful for caching a partial sum)
+    uint16_t partial_sum() const;
+
+    //! Incrementally update a checksum after a 16-bit word of the covered data changed (RFC 1624)
+    static uint16_t adjust16(const uint16_t cksum, const uint16_t old_word, const uint16_t new_word);
 };
 
 //! Hexdump the contents of a packet (or any other sequence of bytes)
@@ -1,49 +1,11 @@
-#include <iostream>
 #include "wrapping_integers.hh"
 
-// Dummy implementation of a 32-bit wrapping integer
-
-// For Lab 2, please replace with a real implementation that passes the
-// automated checks run by `make check_lab2`.
-
 using namespace std;
 
-//! Transform an "absolute" 64-bit sequence number (zero-indexed) into a WrappingInt32
-//! \param n The input absolute 64-bit sequence number
-//! \param isn The initial sequence number
-WrappingInt32 wrap(uint64_t n, WrappingInt32 isn) {    
-    return isn + n;
-}
-
-//! Transform a WrappingInt32 into an "absolute" 64-bit sequence number (zero-indexed)
-//! \param n The relative sequence number
-//! \param isn The initial sequence number
-//! \param checkpoint A recent absolute 64-bit sequence number
-//! \returns the 64-bit sequence number that wraps to `n` and is closest to `checkpoint`
-//!
-//! \note Each of the two streams of the TCP connection has its own ISN. One stream
-//! runs from the local TCPSender to the remote TCPReceiver and has one ISN,
-//! and the other stream runs from the remote TCPSender to the local TCPReceiver and
-//! has a different ISN.
-uint64_t unwrap(WrappingInt32 n, WrappingInt32 isn, uint64_t checkpoint) {
-    int64_t m = n.raw_value() - isn.raw_value();
-    if (m < 0){
-        m += 1l << 32;
+//! \details unwrap() is inline and has no branches, so the compiler hoists wrap(checkpoint) out of the loop and is
+//! free to vectorize what's left.
+void unwrap_n(const WrappingInt32 *n, size_t count, WrappingInt32 isn, uint64_t checkpoint, uint64_t *out) {
+    for (size_t i = 0; i < count; i++){
+        out[i] = unwrap(n[i], isn, checkpoint);
     }
-
-    uint64_t temp1 = uint64_t(m);
-    uint64_t temp2;
-    temp1 += ((checkpoint >> 32) << 32);
-    if (temp1 < checkpoint){
-        temp2 = temp1 + (1l << 32);
-    }else{
-        temp2 = temp1;
-        if (temp1 < (1l << 32)){
-            return temp1;
-        }else{
-            temp1 -= 1l << 32;
-        }
-    }
-
-    return (checkpoint - temp1 < temp2 - checkpoint) ? temp1 : temp2;
-}
\ No newline at end of file
+}
@@ -1,6 +1,7 @@
 #ifndef SPONGE_LIBSPONGE_WRAPPING_INTEGERS_HH
 #define SPONGE_LIBSPONGE_WRAPPING_INTEGERS_HH
 
+#include <cstddef>
 #include <cstdint>
 #include <ostream>
 
@@ -12,16 +13,18 @@ class WrappingInt32 {
 
   public:
     //! Construct from a raw 32-bit unsigned integer
-    explicit WrappingInt32(uint32_t raw_value) : _raw_value(raw_value) {}
+    constexpr explicit WrappingInt32(uint32_t raw_value) : _raw_value(raw_value) {}
 
-    uint32_t raw_value() const { return _raw_value; }  //!< Access raw stored value
+    constexpr uint32_t raw_value() const { return _raw_value; }  //!< Access raw stored value
 };
 
 //! Transform a 64-bit absolute sequence number (zero-indexed) into a 32-bit relative sequence number
 //! \param n the absolute sequence number
 //! \param isn the initial sequence number
 //! \returns the relative sequence number
-WrappingInt32 wrap(uint64_t n, WrappingInt32 isn);
+constexpr WrappingInt32 wrap(uint64_t n, WrappingInt32 isn) {
+    return WrappingInt32{isn.raw_value() + static_cast<uint32_t>(n)};
+}
 
 //! Transform a 32-bit relative sequence number into a 64-bit absolute sequence number (zero-indexed)
 //! \param n The relative sequence number
@@ -33,7 +36,24 @@ WrappingInt32 wrap(uint64_t n, WrappingInt32 isn);
 //! runs from the local TCPSender to the remote TCPReceiver and has one ISN,
 //! and the other stream runs from the remote TCPSender to the local TCPReceiver and
 //! has a different ISN.
-uint64_t unwrap(WrappingInt32 n, WrappingInt32 isn, uint64_t checkpoint);
+//!
+//! \details Without branches: `n` is within 2^31 steps either side of `wrap(checkpoint)`, so the signed 32-bit
+//! difference between them is the offset from `checkpoint`. The difference is biased to count up from 2^31 - 1
+//! steps behind, which makes exactly halfway round count as ahead, and an offset that would take the result below
+//! zero goes round the other way instead.
+constexpr uint64_t unwrap(WrappingInt32 n, WrappingInt32 isn, uint64_t checkpoint) {
+    const uint64_t biased = static_cast<uint32_t>(n.raw_value() - wrap(checkpoint, isn).raw_value() + INT32_MAX);
+    const uint64_t result = checkpoint + biased - INT32_MAX;
+    return result + (static_cast<uint64_t>(checkpoint + biased < INT32_MAX) << 32);
+}
+
+//! Unwrap `count` relative sequence numbers against the same `checkpoint`, as unwrap() would each of them
+//! \param n The relative sequence numbers
+//! \param count How many there are
+//! \param isn The initial sequence number
+//! \param checkpoint A recent absolute sequence number
+//! \param[out] out Where to put the `count` absolute sequence numbers
+void unwrap_n(const WrappingInt32 *n, size_t count, WrappingInt32 isn, uint64_t checkpoint, uint64_t *out);
 
 //! \name Helper functions
 //!@{
@@ -44,22 +64,22 @@ uint64_t unwrap(WrappingInt32 n, WrappingInt32 isn, uint64_t checkpoint);
 //! \returns the number of increments needed to get from `b` to `a`,
 //! negative if the number of decrements needed is less than or equal to
 //! the number of increments
-inline int32_t operator-(WrappingInt32 a, WrappingInt32 b) { return a.raw_value() - b.raw_value(); }
+constexpr int32_t operator-(WrappingInt32 a, WrappingInt32 b) { return a.raw_value() - b.raw_value(); }
 
 //! \brief Whether the two integers are equal.
-inline bool operator==(WrappingInt32 a, WrappingInt32 b) { return a.raw_value() == b.raw_value(); }
+constexpr bool operator==(WrappingInt32 a, WrappingInt32 b) { return a.raw_value() == b.raw_value(); }
 
 //! \brief Whether the two integers are not equal.
-inline bool operator!=(WrappingInt32 a, WrappingInt32 b) { return !(a == b); }
+constexpr bool operator!=(WrappingInt32 a, WrappingInt32 b) { return !(a == b); }
 
 //! \brief Serializes the wrapping integer, `a`.
 inline std::ostream &operator<<(std::ostream &os, WrappingInt32 a) { return os << a.raw_value(); }
 
 //! \brief The point `b` steps past `a`.
-inline WrappingInt32 operator+(WrappingInt32 a, uint32_t b) { return WrappingInt32{a.raw_value() + b}; }
+constexpr WrappingInt32 operator+(WrappingInt32 a, uint32_t b) { return WrappingInt32{a.raw_value() + b}; }
 
 //! \brief The point `b` steps before `a`.
-inline WrappingInt32 operator-(WrappingInt32 a, uint32_t b) { return a + -b; }
+constexpr WrappingInt32 operator-(WrappingInt32 a, uint32_t b) { return a + -b; }
 //!@}
 
 #endif  // SPONGE_LIBSPONGE_WRAPPING_INTEGERS_HH
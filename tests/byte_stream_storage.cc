@@ -0,0 +1,142 @@
+#include "buffer.hh"
+#include "byte_stream.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <cstddef>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// Count heap allocations, the bytes they asked for, and the bytes still held. Each block starts with its size.
+static size_t allocations = 0;
+static size_t allocated_bytes = 0;
+static size_t live_bytes = 0;
+static constexpr size_t PREFIX = alignof(max_align_t);
+
+void *operator new(size_t size) {
+    ++allocations;
+    allocated_bytes += size;
+    if (void *ptr = malloc(size + PREFIX)) {
+        live_bytes += size;
+        *static_cast<size_t *>(ptr) = size;
+        return static_cast<char *>(ptr) + PREFIX;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    if (ptr) {
+        void *block = static_cast<char *>(ptr) - PREFIX;
+        live_bytes -= *static_cast<size_t *>(block);
+        free(block);
+    }
+}
+
+void operator delete(void *ptr, size_t) noexcept { operator delete(ptr); }
+
+int main() {
+    try {
+        // an idle stream holds no storage
+        {
+            const size_t before = allocations;
+            ByteStream stream{TCPConfig::DEFAULT_CAPACITY};
+            if (allocations != before or stream.buffer_size() != 0 or stream.peek_output(10) != "") {
+                throw runtime_error("constructing a ByteStream allocated memory");
+            }
+            stream.pop_output(10);
+            stream.write("");
+            if (allocations != before) {
+                throw runtime_error("ByteStream with nothing written allocated memory");
+            }
+        }
+
+        // a stream takes its storage on the first write, and gives it back once drained, for the next one
+        {
+            ByteStream stream{TCPConfig::DEFAULT_CAPACITY};
+            stream.write("hello");
+            stream.write(" world");
+            if (stream.read(100) != "hello world" or not stream.buffer_empty()) {
+                throw runtime_error("ByteStream lost data");
+            }
+
+            const size_t before = allocations;
+            ByteStream other{TCPConfig::DEFAULT_CAPACITY};
+            other.write("again");
+            if (allocations != before or other.read(100) != "again") {
+                throw runtime_error("drained storage wasn't reused");
+            }
+        }
+
+        // many small writes share slabs, rather than each taking one
+        {
+            constexpr size_t writes = 64000;
+            ByteStream stream{writes};
+            const size_t before = allocated_bytes;
+            for (size_t i = 0; i < writes; i++) {
+                stream.write("x");
+            }
+            if (allocated_bytes - before > 4 * writes) {
+                throw runtime_error(to_string(writes) + " one-byte writes took " +
+                                    to_string(allocated_bytes - before) + " bytes of memory");
+            }
+            if (stream.read(writes) != string(writes, 'x')) {
+                throw runtime_error("ByteStream lost small writes");
+            }
+        }
+
+        // a connection holds stream storage only while it has data buffered
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(TCPConfig{});
+            const size_t idle = BufferPool::free_lists();
+
+            test.execute(Write{"hello"});
+            test.execute(ExpectOneSegment{}.with_data("hello"));
+            test.execute(SendSegment{}.with_ack(true).with_ackno(6).with_seqno(1).with_win(65000).with_data("world"));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(6));
+            if (BufferPool::free_lists() != idle - 1) {
+                throw runtime_error("connection with unread data has no storage for it");
+            }
+            if (test._fsm.inbound_stream().read(100) != "world") {
+                throw runtime_error("connection lost data");
+            }
+            if (BufferPool::free_lists() != idle) {
+                throw runtime_error("idle connection kept its stream storage");
+            }
+
+            // with everything acknowledged and read, an idle connection holds only itself and its segment queues
+            // (a std::queue allocates even when empty, and the two in the public interface stay as they are)
+            size_t queue_bytes = live_bytes;
+            {
+                const queue<TCPSegment> empty{};
+                queue_bytes = live_bytes - queue_bytes;
+            }
+            const size_t budget = sizeof(TCPConnection) + 2 * queue_bytes;
+
+            auto conn = make_unique<TCPConnection>(move(test._fsm));
+            const size_t before = live_bytes;
+            conn.reset();
+            if (before - live_bytes > budget) {
+                throw runtime_error("idle connection holds " + to_string(before - live_bytes) +
+                                    " bytes of heap, over its budget of " + to_string(budget));
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,123 @@
+#include "buffer.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Count heap allocations big enough to hold a segment's payload
+static size_t payload_sized_allocations = 0;
+
+void *operator new(size_t size) {
+    if (size >= TCPConfig::MAX_PAYLOAD_SIZE) {
+        ++payload_sized_allocations;
+    }
+    if (void *ptr = malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { free(ptr); }
+
+void operator delete(void *ptr, size_t) noexcept { free(ptr); }
+
+static uint64_t pool_acquisitions() {
+    const auto &stats = BufferPool::stats();
+    return stats.hits + stats.misses + stats.oversized;
+}
+
+static TCPSegment pop_segment(TCPConnection &conn) {
+    if (conn.segments_out().empty()) {
+        throw runtime_error("expected a segment, but none was sent");
+    }
+    TCPSegment seg = move(conn.segments_out().front());
+    conn.segments_out().pop();
+    return seg;
+}
+
+int main() {
+    try {
+        constexpr size_t NSEGS = 4;
+
+        TCPConfig cfg{};
+        cfg.fixed_isn = WrappingInt32{0};
+        TCPConnection conn{cfg};
+
+        // handshake
+        conn.connect();
+        const TCPSegment syn = pop_segment(conn);
+
+        TCPSegment syn_ack;
+        syn_ack.header().syn = true;
+        syn_ack.header().ack = true;
+        syn_ack.header().seqno = WrappingInt32{1000};
+        syn_ack.header().ackno = syn.header().seqno + 1;
+        syn_ack.header().win = 65000;
+        conn.segment_received(syn_ack);
+        pop_segment(conn);
+
+        // send NSEGS full-sized segments: the data is copied once into the stream, and each segment's payload
+        // once out of it, after which the segment is only moved
+        const string data(NSEGS * TCPConfig::MAX_PAYLOAD_SIZE, 'x');
+        const uint64_t first_acquisitions = pool_acquisitions();
+        const uint64_t first_misses = BufferPool::stats().misses;
+        payload_sized_allocations = 0;
+
+        conn.write(data);
+
+        const uint64_t slabs_allocated = BufferPool::stats().misses - first_misses;
+        if (pool_acquisitions() - first_acquisitions != 1 + NSEGS) {
+            throw runtime_error("first send stored payloads " + to_string(pool_acquisitions() - first_acquisitions) +
+                                " times, expected " + to_string(1 + NSEGS));
+        }
+        if (payload_sized_allocations != 1 + slabs_allocated) {
+            throw runtime_error("first send made " + to_string(payload_sized_allocations - slabs_allocated) +
+                                " payload-sized heap allocations besides slabs, expected 1");
+        }
+
+        vector<TCPSegment> sent;
+        while (not conn.segments_out().empty()) {
+            sent.push_back(pop_segment(conn));
+        }
+        if (sent.size() != NSEGS) {
+            throw runtime_error("expected " + to_string(NSEGS) + " segments, got " + to_string(sent.size()));
+        }
+
+        // a retransmission must reuse the payload kept by the sender, not copy it
+        const uint64_t acquisitions_before = pool_acquisitions();
+        payload_sized_allocations = 0;
+
+        conn.tick(cfg.rt_timeout);
+        const TCPSegment retx = pop_segment(conn);
+
+        if (pool_acquisitions() != acquisitions_before) {
+            throw runtime_error("retransmission allocated new Buffer storage");
+        }
+        if (payload_sized_allocations != 0) {
+            throw runtime_error("retransmission made " + to_string(payload_sized_allocations) +
+                                " payload-sized heap allocations");
+        }
+        if (retx.header().seqno != sent.front().header().seqno) {
+            throw runtime_error("retransmitted the wrong segment");
+        }
+        if (retx.payload().str().data() != sent.front().payload().str().data()) {
+            throw runtime_error("retransmitted payload doesn't share storage with the original");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,298 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "ipv4_reassembler.hh"
+#include "network_interface.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+static InternetDatagram make_datagram(const uint16_t id, const size_t payload_size) {
+    InternetDatagram dgram;
+    dgram.header().src = (10u << 24) | 1;
+    dgram.header().dst = (10u << 24) | 2;
+    dgram.header().id = id;
+    dgram.header().df = false;
+    dgram.header().proto = IPv4Header::PROTO_UDP;
+    string payload(payload_size, 0);
+    for (size_t i = 0; i < payload_size; i++) {
+        payload[i] = char(i * 7 + id);
+    }
+    dgram.payload() = move(payload);
+    dgram.header().len = dgram.header().hlen * 4 + payload_size;
+    return dgram;
+}
+
+// the datagram as it would arrive: serialized and parsed again
+static InternetDatagram reparse(const InternetDatagram &dgram) {
+    InternetDatagram parsed;
+    if (parsed.parse(dgram.serialize().concatenate()) != ParseResult::NoError) {
+        throw runtime_error("datagram doesn't parse");
+    }
+    return parsed;
+}
+
+static void check_same(const InternetDatagram &actual, const InternetDatagram &expected, const string &what) {
+    if (actual.header().len != expected.header().len or actual.header().id != expected.header().id or
+        actual.header().mf or actual.header().offset != 0 or
+        actual.payload().concatenate() != expected.payload().concatenate()) {
+        throw runtime_error(what + ": reassembled datagram differs from the original");
+    }
+    reparse(actual);
+}
+
+static void test_fragment() {
+    const InternetDatagram dgram = make_datagram(1, 4000);
+    const vector<InternetDatagram> fragments = dgram.fragment(1500);
+    if (fragments.size() != 3) {
+        throw runtime_error("expected 3 fragments, got " + to_string(fragments.size()));
+    }
+    size_t offset = 0;
+    for (size_t i = 0; i < fragments.size(); i++) {
+        const IPv4Header &header = fragments[i].header();
+        if (header.len > 1500 or header.offset * 8 != offset or header.mf != (i + 1 < fragments.size()) or
+            header.id != 1 or header.len != 4 * header.hlen + fragments[i].payload().size()) {
+            throw runtime_error("fragment " + to_string(i) + " has a wrong header");
+        }
+        offset += fragments[i].payload().size();
+        reparse(fragments[i]);
+    }
+    if (offset != 4000) {
+        throw runtime_error("fragments don't add up to the datagram");
+    }
+
+    // a fragment split again keeps its place, and its MF flag
+    const vector<InternetDatagram> pieces = fragments[1].fragment(600);
+    if (pieces.front().header().offset != fragments[1].header().offset or not pieces.back().header().mf) {
+        throw runtime_error("re-fragmented fragment has wrong offsets or flags");
+    }
+}
+
+static void test_fragment_options() {
+    InternetDatagram dgram = make_datagram(2, 4000);
+    dgram.header().hlen = 8;
+    dgram.header().len = 4 * 8 + 4000;
+    const vector<InternetDatagram> fragments = dgram.fragment(1500);
+
+    // only the first fragment keeps the options
+    string payload;
+    for (size_t i = 0; i < fragments.size(); i++) {
+        const IPv4Header &header = fragments[i].header();
+        if (header.hlen != (i == 0 ? 8 : 5) or header.len > 1500 or header.offset * 8 != payload.size() or
+            header.len != 4 * header.hlen + fragments[i].payload().size()) {
+            throw runtime_error("fragment " + to_string(i) + " of a datagram with options has a wrong header");
+        }
+        payload += fragments[i].payload().concatenate();
+        reparse(fragments[i]);
+    }
+    if (payload != dgram.payload().concatenate()) {
+        throw runtime_error("fragments of a datagram with options don't add up to it");
+    }
+}
+
+static void test_reassembly() {
+    mt19937 rng(1234);
+    IPv4Reassembler reassembler;
+
+    // a datagram that isn't a fragment goes straight through
+    const InternetDatagram small = make_datagram(2, 100);
+    if (not reassembler.push(small).has_value() or reassembler.datagrams_in_progress() != 0) {
+        throw runtime_error("unfragmented datagram was held back");
+    }
+
+    // fragments in any order, with duplicates, and interleaved with another datagram's
+    for (size_t round = 0; round < 20; round++) {
+        const InternetDatagram first = make_datagram(100 + round, 3000 + round * 37);
+        const InternetDatagram second = make_datagram(200 + round, 2000 + round * 11);
+        vector<InternetDatagram> arrivals;
+        for (const auto &fragment : first.fragment(576)) {
+            arrivals.push_back(reparse(fragment));
+        }
+        for (const auto &fragment : second.fragment(576)) {
+            arrivals.push_back(reparse(fragment));
+        }
+        shuffle(arrivals.begin(), arrivals.end(), rng);
+        arrivals.insert(arrivals.begin() + 1, arrivals.front());
+
+        size_t completed = 0;
+        for (const auto &fragment : arrivals) {
+            const optional<InternetDatagram> whole = reassembler.push(fragment);
+            if (whole.has_value()) {
+                check_same(whole.value(), whole->header().id == first.header().id ? first : second, "shuffled");
+                completed++;
+            }
+        }
+        if (completed != 2 or reassembler.datagrams_in_progress() != 0 or reassembler.stats().buffered_bytes != 0) {
+            throw runtime_error("shuffled fragments weren't reassembled exactly once each");
+        }
+    }
+    if (reassembler.stats().duplicates != 20) {
+        throw runtime_error("duplicate fragments weren't counted");
+    }
+
+    // fragments from another source, or of another protocol, belong to another datagram
+    const InternetDatagram dgram = make_datagram(3, 2000);
+    vector<InternetDatagram> fragments = dgram.fragment(1000);
+    InternetDatagram impostor = fragments[1];
+    impostor.header().src++;
+    reassembler.push(fragments[0]);
+    if (reassembler.push(impostor).has_value() or reassembler.datagrams_in_progress() != 2) {
+        throw runtime_error("fragment from another source was mixed in");
+    }
+    const bool early = reassembler.push(fragments[2]).has_value();
+    const optional<InternetDatagram> whole = reassembler.push(fragments[1]);
+    if (early or not whole.has_value()) {
+        throw runtime_error("datagram wasn't reassembled when its last fragment arrived");
+    }
+}
+
+static void test_overlap() {
+    IPv4Reassembler reassembler;
+    const InternetDatagram dgram = make_datagram(4, 2000);
+    vector<InternetDatagram> fragments = dgram.fragment(1000);
+
+    // an overlapping fragment, shifted by 8 bytes, discards what was held
+    InternetDatagram overlapping = fragments[1];
+    overlapping.header().offset -= 1;
+    reassembler.push(fragments[0]);
+    reassembler.push(overlapping);
+    if (reassembler.datagrams_in_progress() != 0 or reassembler.stats().dropped_overlap != 1) {
+        throw runtime_error("overlapping fragment didn't discard the datagram");
+    }
+
+    // and so does a second "last" fragment ending somewhere else
+    InternetDatagram short_last = fragments[2];
+    short_last.payload() = short_last.payload().concatenate().substr(8);
+    short_last.header().len -= 8;
+    reassembler.push(fragments[2]);
+    reassembler.push(short_last);
+    if (reassembler.datagrams_in_progress() != 0 or reassembler.stats().dropped_overlap != 2) {
+        throw runtime_error("inconsistent last fragment didn't discard the datagram");
+    }
+
+    // a fragment followed by others mustn't have a length that isn't a multiple of 8
+    InternetDatagram ragged = fragments[0];
+    ragged.payload() = ragged.payload().concatenate().substr(3);
+    ragged.header().len -= 3;
+    reassembler.push(ragged);
+    if (reassembler.datagrams_in_progress() != 0 or reassembler.stats().bad_fragments != 1) {
+        throw runtime_error("malformed fragment was held");
+    }
+}
+
+static void test_limits() {
+    // incomplete datagrams time out
+    IPv4Reassembler reassembler(1000, 8, 16 * 1024);
+    reassembler.push(make_datagram(5, 2000).fragment(1000)[0]);
+    reassembler.tick(999);
+    if (reassembler.datagrams_in_progress() != 1) {
+        throw runtime_error("datagram timed out early");
+    }
+    reassembler.tick(1);
+    if (reassembler.datagrams_in_progress() != 0 or reassembler.stats().dropped_timeout != 1 or
+        reassembler.stats().buffered_bytes != 0) {
+        throw runtime_error("datagram didn't time out");
+    }
+
+    // a flood of first fragments that never get completed only ever holds the newest few
+    for (uint16_t id = 0; id < 1000; id++) {
+        reassembler.push(make_datagram(id, 4000).fragment(1500)[0]);
+        if (reassembler.datagrams_in_progress() > 8 or reassembler.stats().buffered_bytes > 16 * 1024) {
+            throw runtime_error("reassembler grew past its limits");
+        }
+    }
+    if (reassembler.stats().dropped_evicted != 1000 - reassembler.datagrams_in_progress()) {
+        throw runtime_error("evictions weren't counted");
+    }
+
+    // and a datagram that arrives in one go still gets through
+    const InternetDatagram dgram = make_datagram(2000, 3000);
+    optional<InternetDatagram> whole;
+    for (const auto &fragment : dgram.fragment(1500)) {
+        whole = reassembler.push(fragment);
+    }
+    if (not whole.has_value()) {
+        throw runtime_error("datagram wasn't reassembled during the flood");
+    }
+    check_same(whole.value(), dgram, "flood");
+
+    // as do datagrams made of more fragments than the reassembler takes
+    const vector<InternetDatagram> tiny = make_datagram(2001, 8 * (IPv4Reassembler::MAX_FRAGMENTS + 1)).fragment(28);
+    for (const auto &fragment : tiny) {
+        if (reassembler.push(fragment).has_value()) {
+            throw runtime_error("datagram with too many fragments was reassembled");
+        }
+    }
+}
+
+static void test_network_interface() {
+    const EthernetAddress local{0x02, 0, 0, 0, 0, 1}, remote{0x02, 0, 0, 0, 0, 2};
+    NetworkInterface interface(local, Address("10.0.0.1"));
+    interface.set_mtu(1000);
+
+    // the neighbor introduces itself
+    ARPMessage arp;
+    arp.opcode = ARPMessage::OPCODE_REQUEST;
+    arp.sender_ethernet_address = remote;
+    arp.sender_ip_address = (10u << 24) | 2;
+    arp.target_ip_address = (10u << 24) | 1;
+    EthernetFrame frame;
+    frame.header() = {local, remote, EthernetHeader::TYPE_ARP};
+    frame.payload() = arp.serialize();
+    interface.recv_frame(frame);
+    interface.frames_out() = {};
+
+    // a datagram larger than the MTU is sent in fragments that fit, which reassemble to the original
+    const InternetDatagram dgram = make_datagram(6, 2500);
+    interface.send_datagram(dgram, Address("10.0.0.2"));
+    IPv4Reassembler reassembler;
+    optional<InternetDatagram> whole;
+    size_t frames = 0;
+    while (not interface.frames_out().empty()) {
+        const EthernetFrame &sent = interface.frames_out().front();
+        InternetDatagram fragment;
+        if (sent.header().dst != remote or fragment.parse(sent.payload().concatenate()) != ParseResult::NoError or
+            fragment.header().len > 1000) {
+            throw runtime_error("fragment sent badly");
+        }
+        whole = reassembler.push(fragment);
+        interface.frames_out().pop();
+        frames++;
+    }
+    if (frames != 3 or not whole.has_value() or interface.stats().fragments_created != 3) {
+        throw runtime_error("datagram wasn't sent in 3 fragments");
+    }
+    check_same(whole.value(), dgram, "interface");
+
+    // unless its DF flag forbids it
+    InternetDatagram dont_fragment = make_datagram(7, 2500);
+    dont_fragment.header().df = true;
+    interface.send_datagram(dont_fragment, Address("10.0.0.2"));
+    if (not interface.frames_out().empty() or interface.stats().dropped_too_big != 1) {
+        throw runtime_error("datagram with DF set was sent anyway");
+    }
+}
+
+int main() {
+    try {
+        test_fragment();
+        test_fragment_options();
+        test_reassembly();
+        test_overlap();
+        test_limits();
+        test_network_interface();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -13,6 +13,7 @@
 #include <iostream>
 #include <pcap/pcap.h>
 #include <string>
+#include <utility>
 #include <vector>
 
 using namespace std;
@@ -163,6 +164,7 @@ int main(int argc, char **argv) {
         }
 
         bool ok = true;
+        vector<Buffer> parsed_datagrams;
         const uint8_t *pkt;
         struct pcap_pkthdr hdr;
         while ((pkt = pcap_next(pcap, &hdr)) != nullptr) {
@@ -188,6 +190,25 @@ int main(int argc, char **argv) {
                 continue;
             }
 
+            parsed_datagrams.emplace_back(string(pkt + 14, pkt + hdr.caplen));
+
+            // forwarding patches the checksum incrementally; it must match a full recomputation
+            if (as_const(ip_dgram).header().ttl > 1) {
+                IPv4Datagram forwarded = ip_dgram;
+                forwarded.decrement_ttl();
+
+                IPv4Datagram recomputed;
+                recomputed.header() = as_const(forwarded).header();
+                recomputed.payload() = forwarded.payload();
+
+                if (forwarded.serialize().concatenate() != recomputed.serialize().concatenate()) {
+                    cout << "ERROR: incrementally updated IP checksum doesn't match recomputed checksum.\n";
+                    cout << as_const(forwarded).header().to_string();
+                    ok = false;
+                    continue;
+                }
+            }
+
             TCPSegment tcp_seg;
             if (auto res = tcp_seg.parse(ip_dgram.payload(), ip_dgram.header().pseudo_cksum());
                 res != ParseResult::NoError) {
@@ -305,6 +326,12 @@ int main(int argc, char **argv) {
         if (!ok) {
             return EXIT_FAILURE;
         }
+
+        report_parse_throughput("IPv4 header", parsed_datagrams, [](const Buffer &datagram) {
+            NetParser p{datagram};
+            IPv4Header header;
+            return header.parse(p) == ParseResult::NoError;
+        });
     } catch (const exception &e) {
         cout << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
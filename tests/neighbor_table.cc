@@ -0,0 +1,57 @@
+#include "neighbor_table.hh"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+using namespace std;
+
+int main() {
+    try {
+        // compare against std::unordered_map through a long run of random adds, changes and removals,
+        // drawing addresses from a small range so that probe runs collide and wrap around often
+        mt19937 rng{144};
+        NeighborTable table;
+        unordered_map<uint32_t, size_t> expected;
+
+        for (size_t step = 0; step < 200'000; step++) {
+            const uint32_t ip = (10u << 24) | (rng() % 512) << 4;
+            switch (rng() % 3) {
+                case 0:
+                    table[ip].expires_at = step;
+                    expected[ip] = step;
+                    break;
+                case 1:
+                    table.erase(ip);
+                    expected.erase(ip);
+                    break;
+                default: {
+                    const Neighbor *neighbor = table.find(ip);
+                    const auto it = expected.find(ip);
+                    if ((neighbor == nullptr) != (it == expected.end()) or
+                        (neighbor and neighbor->expires_at != it->second)) {
+                        throw runtime_error("lookup disagrees with std::unordered_map at step " + to_string(step));
+                    }
+                }
+            }
+            if (table.size() != expected.size()) {
+                throw runtime_error("size disagrees with std::unordered_map at step " + to_string(step));
+            }
+        }
+
+        for (const auto &[ip, expires_at] : expected) {
+            const Neighbor *neighbor = table.find(ip);
+            if (neighbor == nullptr or neighbor->expires_at != expires_at) {
+                throw runtime_error("neighbor lost");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
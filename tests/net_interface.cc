@@ -5,6 +5,8 @@
 
 #include <cstdlib>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 
 using namespace std;
 
@@ -313,6 +315,136 @@ int main() {
                            make_arp(ARPMessage::OPCODE_REQUEST, local_eth, "10.0.0.1", {}, "10.0.0.5").serialize())});
             test.execute(ExpectNoFrame{});
         }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            NetworkInterface interface{local_eth, Address("10.0.0.1", 0)};
+            auto check = [&](const bool ok, const string &what) {
+                if (not ok) {
+                    throw runtime_error("pending datagram limits: " + what);
+                }
+            };
+            auto frames_sent = [&] {
+                const size_t count = interface.frames_out().size();
+                interface.frames_out() = {};
+                return count;
+            };
+
+            // a flood toward one unresolved neighbor keeps only the newest 64 datagrams
+            for (size_t i = 0; i < 100; i++) {
+                interface.send_datagram(make_datagram("5.6.7.8", "13.12.11." + to_string(i)), Address("10.0.0.2", 0));
+            }
+            check(frames_sent() == 1, "expected a single ARP request");
+            check(interface.stats().pending_datagrams == 64, "neighbor queue not capped");
+            check(interface.stats().dropped_neighbor_full == 36, "drops not counted");
+
+            const EthernetAddress remote_eth = random_private_ethernet_address();
+            interface.recv_frame(make_frame(
+                remote_eth,
+                local_eth,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REPLY, remote_eth, "10.0.0.2", local_eth, "10.0.0.1").serialize()));
+            check(interface.frames_out().size() == 64, "expected the 64 queued datagrams to be sent");
+            InternetDatagram first;
+            check(first.parse(interface.frames_out().front().payload().concatenate()) == ParseResult::NoError and
+                      first.header().dst == Address("13.12.11.36", 0).ipv4_numeric(),
+                  "expected the oldest datagrams to be the ones dropped");
+            frames_sent();
+            check(interface.stats().pending_datagrams == 0 and interface.stats().pending_bytes == 0,
+                  "queue not drained");
+
+            // many unresolved neighbors share the interface's limit
+            for (size_t n = 0; n < 20; n++) {
+                for (size_t i = 0; i < 64; i++) {
+                    interface.send_datagram(make_datagram("5.6.7.8", "13.12.11.10"),
+                                            Address("10.0.1." + to_string(n), 0));
+                }
+            }
+            check(frames_sent() == 20, "expected an ARP request per neighbor");
+            check(interface.stats().pending_datagrams == 1024, "interface queue not capped");
+            check(interface.stats().dropped_interface_full == 20 * 64 - 1024, "interface drops not counted");
+
+            // and their datagrams are dropped when nobody answers
+            interface.tick(5000);
+            check(interface.stats().pending_datagrams == 0 and interface.stats().pending_bytes == 0,
+                  "unanswered neighbors not reclaimed");
+            check(interface.stats().dropped_unresolved == 1024, "unresolved drops not counted");
+            check(interface.stats().arp_requests_sent == 21, "ARP requests not counted");
+        }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            const EthernetAddress remote_eth = random_private_ethernet_address();
+            NetworkInterface interface{local_eth, Address("10.0.0.1", 0)};
+            auto check = [&](const bool ok, const string &what) {
+                if (not ok) {
+                    throw runtime_error("chatty neighbor: " + what);
+                }
+            };
+            const EthernetFrame announcement = make_frame(
+                remote_eth,
+                ETHERNET_BROADCAST,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REQUEST, remote_eth, "10.0.0.2", {}, "10.0.0.3").serialize());
+
+            // a neighbor heard from over and over keeps a single timer
+            for (size_t i = 0; i < 10000; i++) {
+                interface.recv_frame(announcement);
+                interface.tick(1);
+            }
+            check(interface.expiry_timers() == 1, to_string(interface.expiry_timers()) + " timers for one neighbor");
+
+            // and its mapping still lasts 30 seconds from the last time it was heard from (1 ms ago)
+            interface.tick(29998);
+            interface.send_datagram(make_datagram("5.6.7.8", "13.12.11.10"), Address("10.0.0.2", 0));
+            check(interface.frames_out().size() == 1 and
+                      interface.frames_out().front().header().type == EthernetHeader::TYPE_IPv4,
+                  "refreshed mapping forgotten early");
+            interface.frames_out() = {};
+            interface.tick(1);
+            interface.send_datagram(make_datagram("5.6.7.8", "13.12.11.10"), Address("10.0.0.2", 0));
+            check(interface.frames_out().size() == 1 and
+                      interface.frames_out().front().header().type == EthernetHeader::TYPE_ARP,
+                  "refreshed mapping not forgotten");
+        }
+
+        {
+            const EthernetAddress local_eth = random_private_ethernet_address();
+            const EthernetAddress remote_eth = random_private_ethernet_address();
+            NetworkInterface interface{local_eth, Address("10.0.0.1", 0)};
+            auto check = [&](const bool ok, const string &what) {
+                if (not ok) {
+                    throw runtime_error("framing in place: " + what);
+                }
+            };
+
+            // the datagram's headers, serialized in place, with the payload to follow them
+            const InternetDatagram dgram = make_datagram("5.6.7.8", "13.12.11.10");
+            Headroom room;
+            dgram.serialize_into(room);
+            const string payload = dgram.payload().concatenate();
+
+            check(not interface.frame_into(room, room.size() + payload.size(), Address("10.0.0.2", 0)) and
+                      room.size() == 4 * dgram.header().hlen,
+                  "framed for a neighbor whose address isn't known");
+
+            interface.recv_frame(make_frame(
+                remote_eth,
+                ETHERNET_BROADCAST,
+                EthernetHeader::TYPE_ARP,
+                make_arp(ARPMessage::OPCODE_REQUEST, remote_eth, "10.0.0.2", {}, "10.0.0.1").serialize()));
+            interface.frames_out() = {};
+            check(not interface.frame_into(room, interface.mtu() + 1, Address("10.0.0.2", 0)),
+                  "framed a datagram too big for the link");
+            check(interface.frame_into(room, room.size() + payload.size(), Address("10.0.0.2", 0)),
+                  "didn't frame for a known neighbor");
+
+            // the same frame that send_datagram() makes
+            interface.send_datagram(dgram, Address("10.0.0.2", 0));
+            check(interface.frames_out().size() == 1 and
+                      string(room.str()) + payload == interface.frames_out().front().serialize().concatenate(),
+                  "frame differs from the one send_datagram() makes");
+        }
     } catch (const exception &e) {
         cerr << e.what() << endl;
         return EXIT_FAILURE;
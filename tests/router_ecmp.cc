@@ -0,0 +1,137 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "router.hh"
+
+#include <array>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// interface 0 faces the hosts; interfaces 1 to NUM_UPLINKS each have an upstream router, 192.168.i.2
+constexpr size_t NUM_UPLINKS = 3;
+constexpr size_t NUM_FLOWS = 300;
+
+static EthernetAddress router_ethernet_address(const size_t i) { return {0x02, 0, 0, 0, 0, uint8_t(i)}; }
+static EthernetAddress neighbor_ethernet_address(const size_t i) { return {0x02, 0, 0, 0, 1, uint8_t(i)}; }
+static uint32_t router_ip(const size_t i) { return (192u << 24) | (168u << 16) | (i << 8) | 1; }
+static uint32_t neighbor_ip(const size_t i) { return (192u << 24) | (168u << 16) | (i << 8) | 2; }
+
+static EthernetFrame make_frame(const size_t i, const uint16_t type, BufferList payload) {
+    EthernetFrame frame;
+    frame.header().src = neighbor_ethernet_address(i);
+    frame.header().dst = router_ethernet_address(i);
+    frame.header().type = type;
+    frame.payload() = payload.concatenate();
+    return frame;
+}
+
+// a TCP or UDP datagram from a host behind interface 0, with ports that identify its flow
+static InternetDatagram make_datagram(const size_t flow, const uint8_t proto, const string &data) {
+    InternetDatagram dgram;
+    dgram.header().src = (10u << 24) | (flow % 7);
+    dgram.header().dst = (8u << 24) | (flow % 5);
+    dgram.header().proto = proto;
+    dgram.header().ttl = 64;
+    const uint16_t src_port = 1024 + flow, dst_port = 80;
+    dgram.payload() = string{char(src_port >> 8), char(src_port), char(dst_port >> 8), char(dst_port)} + data;
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+    return dgram;
+}
+
+// route `dgram` in from interface 0, and return the uplink it went out on
+static size_t route(Router &router, const InternetDatagram &dgram) {
+    router.interface(0).recv_frame(make_frame(0, EthernetHeader::TYPE_IPv4, dgram.serialize()));
+    router.route();
+
+    size_t uplink = 0;
+    for (size_t i = 1; i <= NUM_UPLINKS; i++) {
+        auto &frames = router.interface(i).frames_out();
+        while (not frames.empty()) {
+            const EthernetFrame &frame = frames.front();
+            if (frame.header().type != EthernetHeader::TYPE_IPv4 or
+                frame.header().dst != neighbor_ethernet_address(i)) {
+                throw runtime_error("uplink " + to_string(i) + " sent an unexpected frame");
+            }
+            if (uplink != 0) {
+                throw runtime_error("datagram went out more than one uplink");
+            }
+            uplink = i;
+            frames.pop();
+        }
+    }
+    if (uplink == 0) {
+        throw runtime_error("datagram wasn't routed");
+    }
+    return uplink;
+}
+
+int main() {
+    try {
+        Router router;
+        router.add_interface({router_ethernet_address(0), Address{"10.0.0.1"}});
+        vector<RoutePath> uplinks;
+        for (size_t i = 1; i <= NUM_UPLINKS; i++) {
+            router.add_interface({router_ethernet_address(i), Address::from_ipv4_numeric(router_ip(i))});
+            uplinks.push_back({Address::from_ipv4_numeric(neighbor_ip(i)), i});
+
+            // the upstream router introduces itself, so the router doesn't have to ARP for it
+            ARPMessage arp;
+            arp.opcode = ARPMessage::OPCODE_REQUEST;
+            arp.sender_ethernet_address = neighbor_ethernet_address(i);
+            arp.sender_ip_address = neighbor_ip(i);
+            arp.target_ip_address = router_ip(i);
+            router.interface(i).recv_frame(make_frame(i, EthernetHeader::TYPE_ARP, arp.serialize()));
+            router.interface(i).frames_out() = {};
+        }
+        router.add_route(0, 0, uplinks);
+
+        // each flow keeps to one uplink, and the flows between them use all the uplinks
+        for (const uint8_t proto : {IPv4Header::PROTO_TCP, IPv4Header::PROTO_UDP}) {
+            array<size_t, NUM_UPLINKS + 1> flows_per_uplink{};
+            for (size_t flow = 0; flow < NUM_FLOWS; flow++) {
+                const size_t uplink = route(router, make_datagram(flow, proto, "first"));
+                for (size_t n = 0; n < 3; n++) {
+                    if (route(router, make_datagram(flow, proto, "more data " + to_string(n))) != uplink) {
+                        throw runtime_error("flow " + to_string(flow) + " switched uplinks");
+                    }
+                }
+                flows_per_uplink[uplink]++;
+            }
+            for (size_t i = 1; i <= NUM_UPLINKS; i++) {
+                if (flows_per_uplink[i] < NUM_FLOWS / NUM_UPLINKS / 2) {
+                    throw runtime_error("uplink " + to_string(i) + " only carried " + to_string(flows_per_uplink[i]) +
+                                        " of " + to_string(NUM_FLOWS) + " flows");
+                }
+            }
+        }
+
+        // the fragments of a datagram all take the same path, whatever their ports
+        InternetDatagram first_fragment = make_datagram(1, IPv4Header::PROTO_UDP, "fragment");
+        first_fragment.header().mf = true;
+        InternetDatagram later_fragment = make_datagram(2, IPv4Header::PROTO_UDP, "fragment");
+        later_fragment.header().offset = 100;
+        later_fragment.header().src = first_fragment.header().src;
+        later_fragment.header().dst = first_fragment.header().dst;
+        if (Router::flow_hash(first_fragment) != Router::flow_hash(later_fragment)) {
+            throw runtime_error("fragments of one datagram hash differently");
+        }
+
+        // replacing the route with a single path sends every flow that way
+        router.replace_route(0, 0, Address::from_ipv4_numeric(neighbor_ip(2)), 2);
+        for (size_t flow = 0; flow < NUM_FLOWS; flow += 10) {
+            if (route(router, make_datagram(flow, IPv4Header::PROTO_TCP, "single")) != 2) {
+                throw runtime_error("single-path route wasn't followed");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include "arp_message.hh"
+#include "ethernet_frame.hh"
+#include "ipv4_datagram.hh"
+#include "router.hh"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+constexpr size_t NUM_INTERFACES = 4;
+constexpr size_t DATAGRAMS_PER_INTERFACE = 2000;
+
+// interface i is 10.i.0.1, with one directly attached host, 10.i.0.2
+static uint32_t router_ip(const size_t i) { return (10u << 24) | (i << 16) | 1; }
+static uint32_t host_ip(const size_t i) { return (10u << 24) | (i << 16) | 2; }
+
+static EthernetAddress router_ethernet_address(const size_t i) { return {0x02, 0, 0, 0, 0, uint8_t(i)}; }
+static EthernetAddress host_ethernet_address(const size_t i) { return {0x02, 0, 0, 0, 1, uint8_t(i)}; }
+
+static EthernetFrame make_frame(const size_t i, const uint16_t type, BufferList payload) {
+    EthernetFrame frame;
+    frame.header().src = host_ethernet_address(i);
+    frame.header().dst = router_ethernet_address(i);
+    frame.header().type = type;
+    frame.payload() = payload.concatenate();
+    return frame;
+}
+
+// the datagram that host i sends as its n'th, and the interface it's routed to
+static size_t destination(const size_t i, const size_t n) {
+    return (i + 1 + n % (NUM_INTERFACES - 1)) % NUM_INTERFACES;
+}
+
+static InternetDatagram make_datagram(const size_t i, const size_t n) {
+    InternetDatagram dgram;
+    dgram.header().src = host_ip(i);
+    dgram.header().dst = host_ip(destination(i, n));
+    dgram.header().ttl = 64;
+    dgram.payload() = to_string(i) + ":" + to_string(n);
+    dgram.header().len = dgram.header().hlen * 4 + dgram.payload().size();
+    return dgram;
+}
+
+static void deliver(Router &router, const size_t i, EthernetFrame frame) {
+    while (not router.deliver_frame(i, move(frame))) {
+        this_thread::yield();
+    }
+}
+
+int main() {
+    try {
+        Router router;
+        for (size_t i = 0; i < NUM_INTERFACES; i++) {
+            router.add_interface({router_ethernet_address(i), Address::from_ipv4_numeric(router_ip(i))});
+            router.add_route(host_ip(i) & 0xffff'0000, 16, {}, i);
+        }
+
+        router.start(8192);
+
+        // each host introduces itself, so the router doesn't have to ARP for it
+        for (size_t i = 0; i < NUM_INTERFACES; i++) {
+            ARPMessage arp;
+            arp.opcode = ARPMessage::OPCODE_REQUEST;
+            arp.sender_ethernet_address = host_ethernet_address(i);
+            arp.sender_ip_address = host_ip(i);
+            arp.target_ip_address = router_ip(i);
+            deliver(router, i, make_frame(i, EthernetHeader::TYPE_ARP, arp.serialize()));
+        }
+
+        // then every host sends datagrams to the others, each from its own thread
+        vector<thread> senders;
+        for (size_t i = 0; i < NUM_INTERFACES; i++) {
+            senders.emplace_back([&router, i] {
+                for (size_t n = 0; n < DATAGRAMS_PER_INTERFACE; n++) {
+                    deliver(router, i, make_frame(i, EthernetHeader::TYPE_IPv4, make_datagram(i, n).serialize()));
+                }
+            });
+        }
+
+        // meanwhile, routes change over and over, and the workers pick up each snapshot without stopping
+        atomic<bool> done{false};
+        size_t changes = 0;
+        thread churn([&router, &done, &changes] {
+            for (; not done.load(); changes++) {
+                router.replace_route(0xc0a8'0000, 16, {}, changes % NUM_INTERFACES);
+                if (changes % 2) {
+                    router.remove_route(0xc0a8'0000, 16);
+                }
+            }
+        });
+
+        array<size_t, NUM_INTERFACES> expected{};
+        for (size_t i = 0; i < NUM_INTERFACES; i++) {
+            for (size_t n = 0; n < DATAGRAMS_PER_INTERFACE; n++) {
+                expected[destination(i, n)]++;
+            }
+        }
+
+        array<size_t, NUM_INTERFACES> received{};
+        array<array<size_t, NUM_INTERFACES>, NUM_INTERFACES> next_n{};  // by source, then destination
+        size_t total = 0;
+        const auto deadline = chrono::steady_clock::now() + chrono::seconds(20);
+        while (total < NUM_INTERFACES * DATAGRAMS_PER_INTERFACE) {
+            if (chrono::steady_clock::now() > deadline) {
+                throw runtime_error("only " + to_string(total) + " datagrams were routed in time");
+            }
+
+            for (size_t j = 0; j < NUM_INTERFACES; j++) {
+                optional<EthernetFrame> frame = router.take_frame(j);
+                if (not frame.has_value() or frame->header().type != EthernetHeader::TYPE_IPv4) {
+                    continue;
+                }
+                if (frame->header().dst != host_ethernet_address(j) or
+                    frame->header().src != router_ethernet_address(j)) {
+                    throw runtime_error("frame sent with the wrong Ethernet addresses");
+                }
+
+                InternetDatagram dgram;
+                if (dgram.parse(frame->payload().concatenate()) != ParseResult::NoError) {
+                    throw runtime_error("routed datagram doesn't parse");
+                }
+                if (dgram.header().dst != host_ip(j) or dgram.header().ttl != 63) {
+                    throw runtime_error("datagram routed to the wrong interface, or its TTL wasn't decremented");
+                }
+
+                // datagrams from any one host to any other must arrive in the order they were sent
+                const string payload = dgram.payload().concatenate();
+                const size_t i = stoul(payload.substr(0, payload.find(':')));
+                const size_t n = stoul(payload.substr(payload.find(':') + 1));
+                if (i >= NUM_INTERFACES or n < next_n[i][j] or destination(i, n) != j) {
+                    throw runtime_error("datagram " + payload + " arrived out of order");
+                }
+                next_n[i][j] = n + 1;
+                received[j]++;
+                total++;
+            }
+        }
+
+        for (auto &sender : senders) {
+            sender.join();
+        }
+        done.store(true);
+        churn.join();
+
+        // with nothing to do, the workers sleep rather than spin
+        this_thread::sleep_for(chrono::milliseconds(100));
+        const clock_t cpu_before = clock();
+        this_thread::sleep_for(chrono::milliseconds(500));
+        const double idle_cpu = double(clock() - cpu_before) / CLOCKS_PER_SEC;
+        if (idle_cpu > 0.1) {
+            throw runtime_error("idle workers used " + to_string(idle_cpu) + " s of CPU in 0.5 s");
+        }
+
+        router.stop();
+
+        if (changes == 0) {
+            throw runtime_error("routes never changed while routing");
+        }
+
+        for (size_t j = 0; j < NUM_INTERFACES; j++) {
+            if (received[j] != expected[j]) {
+                throw runtime_error("interface " + to_string(j) + " sent " + to_string(received[j]) + " datagrams");
+            }
+        }
+        if (router.ring_drops() != 0) {
+            throw runtime_error(to_string(router.ring_drops()) + " frames were dropped");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+
+using namespace std;
+
+// a segment of the peer's data, `offset` bytes into its stream (which starts at seqno 1)
+static SendSegment data(const size_t offset, string payload) {
+    return SendSegment{}
+        .with_ack(true)
+        .with_ackno(1)
+        .with_win(65000)
+        .with_seqno(uint32_t(1 + offset))
+        .with_data(move(payload));
+}
+
+static TCPConfig delay_config(const uint16_t ack_delay) {
+    TCPConfig cfg{};
+    cfg.ack_delay = ack_delay;
+    return cfg;
+}
+
+int main() {
+    try {
+        const string chunk(100, 'x');
+        const TCPConfig delayed = delay_config(TCPConfig::DELAYED_ACK_TIMEOUT);
+
+        // every second segment is acknowledged, both at once
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(delayed);
+            for (uint32_t pair = 0; pair < 5; pair++) {
+                test.execute(data(200 * pair, chunk));
+                test.execute(ExpectNoSegment{}, "first of a pair was acknowledged at once");
+                test.execute(data(200 * pair + 100, chunk));
+                test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(1 + 200 * (pair + 1)),
+                             "second of a pair wasn't acknowledged along with the first");
+            }
+        }
+
+        // a lone segment is acknowledged once the timer runs out
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(delayed);
+            test.execute(data(0, chunk));
+            test.execute(Tick(TCPConfig::DELAYED_ACK_TIMEOUT - 1));
+            test.execute(ExpectNoSegment{}, "ACK sent before the timer ran out");
+            test.execute(Tick(1));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(101), "no ACK when the timer ran out");
+            test.execute(Tick(1000));
+            test.execute(ExpectNoSegment{}, "delayed ACK was sent again");
+        }
+
+        // out-of-order data gets an immediate (duplicate) ACK, and so does the segment filling the gap
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(delayed);
+            test.execute(data(100, chunk));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(1), "out-of-order data wasn't acknowledged");
+            test.execute(data(0, chunk));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(201), "segment filling the gap wasn't");
+        }
+
+        // as do pushed segments, and FINs
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(delayed);
+            test.execute(data(0, chunk).with_psh(true));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(101), "PSH wasn't acknowledged at once");
+            test.execute(data(100, chunk).with_fin(true));
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(202), "FIN wasn't acknowledged at once");
+        }
+
+        // data sent meanwhile carries the delayed ACK, so no separate ACK follows
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(delayed);
+            test.execute(data(0, chunk));
+            test.execute(ExpectNoSegment{}, "ACK sent before writing");
+            test.execute(Write{"reply"});
+            test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(101).with_data("reply"),
+                         "reply didn't carry the delayed ACK");
+            test.execute(Tick(TCPConfig::DELAYED_ACK_TIMEOUT));
+            test.execute(ExpectNoSegment{}, "ACK sent again after it went with data");
+        }
+
+        // with no delay configured, every segment is acknowledged at once
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(delay_config(0));
+            for (uint32_t i = 0; i < 4; i++) {
+                test.execute(data(100 * i, chunk));
+                test.execute(ExpectOneSegment{}.with_ack(true).with_ackno(1 + 100 * (i + 1)),
+                             "segment wasn't acknowledged at once with no delay");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -387,6 +387,7 @@ struct SendSegment : public TCPAction {
     bool rst{false};
     bool syn{false};
     bool fin{false};
+    bool psh{false};
     WrappingInt32 seqno{0};
     WrappingInt32 ackno{0};
     uint16_t win{0};
@@ -400,6 +401,7 @@ struct SendSegment : public TCPAction {
         rst = seg.header().rst;
         syn = seg.header().syn;
         fin = seg.header().fin;
+        psh = seg.header().psh;
         seqno = seg.header().seqno;
         ackno = seg.header().ackno;
         win = seg.header().win;
@@ -426,6 +428,11 @@ struct SendSegment : public TCPAction {
         return *this;
     }
 
+    SendSegment &with_psh(bool psh_) {
+        psh = psh_;
+        return *this;
+    }
+
     SendSegment &with_seqno(WrappingInt32 seqno_) {
         seqno = seqno_;
         return *this;
@@ -463,6 +470,7 @@ struct SendSegment : public TCPAction {
         data_hdr.rst = rst;
         data_hdr.syn = syn;
         data_hdr.fin = fin;
+        data_hdr.psh = psh;
         data_hdr.ackno = ackno;
         data_hdr.seqno = seqno;
         data_hdr.win = win;
@@ -564,4 +572,14 @@ struct Close : public TCPAction {
     void execute(TCPTestHarness &harness) const { harness._fsm.end_input_stream(); }
 };
 
+struct Cork : public TCPAction {
+    std::string description() const { return "cork"; }
+    void execute(TCPTestHarness &harness) const { harness._fsm.cork(); }
+};
+
+struct Uncork : public TCPAction {
+    std::string description() const { return "uncork"; }
+    void execute(TCPTestHarness &harness) const { harness._fsm.uncork(); }
+};
+
 #endif  // SPONGE_LIBSPONGE_TCP_EXPECTATION_HH
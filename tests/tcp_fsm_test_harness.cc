@@ -220,6 +220,18 @@ TCPTestHarness TCPTestHarness::in_established(const TCPConfig &cfg,
     return h;
 }
 
+//! \brief Create an FSM with an established connection, and a window of `swin` from the peer
+//! \param[in] swin is the window the peer's ACK of the SYN advertises
+TCPTestHarness TCPTestHarness::in_established(const TCPConfig &cfg,
+                                              const uint16_t swin,
+                                              const WrappingInt32 tx_isn,
+                                              const WrappingInt32 rx_isn) {
+    TCPTestHarness h = in_established(cfg, tx_isn, rx_isn);
+    h.send_ack(rx_isn + 1, tx_isn + 1, swin);
+    h.execute(ExpectNoSegment{});
+    return h;
+}
+
 //! \brief Create an FSM in CLOSE_WAIT
 //! \details SYNs have been traded, and then the machine received and ACK'd FIN.
 //! \param[in] tx_isn is the ISN of the FSM's outbound sequence. i.e. the
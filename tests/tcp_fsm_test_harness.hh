@@ -125,6 +125,13 @@ class TCPTestHarness {
                                          const WrappingInt32 tx_isn = WrappingInt32{0},
                                          const WrappingInt32 rx_isn = WrappingInt32{0});
 
+    //! \brief Create an FSM with an established connection, whose peer has since opened its window to `swin`
+    //! \details As in_established(), followed by the peer's ACK of the SYN with the new window, which goes unanswered.
+    static TCPTestHarness in_established(const TCPConfig &cfg,
+                                         const uint16_t swin,
+                                         const WrappingInt32 tx_isn = WrappingInt32{0},
+                                         const WrappingInt32 rx_isn = WrappingInt32{0});
+
     //! \brief Create an FSM in CLOSE_WAIT
     //! \details SYNs have been traded, and then the machine received and ACK'd FIN.
     //!          No payload was exchanged.
@@ -0,0 +1,205 @@
+#include "address.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_listener.hh"
+#include "tcp_listener_test_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using State = TCPTestHarness::State;
+
+constexpr uint32_t IDLE = 1000;
+constexpr uint32_t INTVL = 100;
+constexpr unsigned PROBES = 3;
+
+static TCPConfig keepalive_config() {
+    TCPConfig cfg{};
+    cfg.keepalive_idle = IDLE;
+    cfg.keepalive_intvl = INTVL;
+    cfg.keepalive_probes = PROBES;
+    return cfg;
+}
+
+// a keepalive probe: an empty segment one byte behind what the connection has sent, which is just its SYN
+static void expect_probe(TCPTestHarness &test, const string &what) {
+    test.execute(ExpectOneSegment{}.with_ack(true).with_seqno(0).with_payload_size(0), what);
+}
+
+static void test_connection() {
+    // an idle connection probes its peer, and anything the peer sends starts the count again
+    {
+        TCPTestHarness test = TCPTestHarness::in_established(keepalive_config());
+        if (not test._fsm.idle() or test._fsm.keepalive_due() != IDLE) {
+            throw runtime_error("established connection isn't idle");
+        }
+        test.execute(Tick(IDLE - 1));
+        test.execute(ExpectNoSegment{}, "probe sent before the idle time");
+        test.execute(Tick(1));
+        expect_probe(test, "no probe after the idle time");
+        if (test._fsm.keepalive_probes() != 1 or test._fsm.keepalive_due() != INTVL) {
+            throw runtime_error("probe wasn't counted");
+        }
+
+        test.send_ack(WrappingInt32{1}, WrappingInt32{1});
+        test.execute(ExpectNoSegment{}, "peer's answer to the probe was answered");
+        if (test._fsm.keepalive_probes() != 0 or test._fsm.keepalive_due() != IDLE) {
+            throw runtime_error("peer's answer didn't restart keepalive");
+        }
+    }
+
+    // a peer that doesn't answer is given up on
+    {
+        TCPTestHarness test = TCPTestHarness::in_established(keepalive_config());
+        test.execute(Tick(IDLE));
+        expect_probe(test, "no first probe");
+        for (unsigned i = 1; i < PROBES; i++) {
+            test.execute(Tick(INTVL - 1));
+            test.execute(ExpectNoSegment{}, "probe sent too soon after the last");
+            test.execute(Tick(1));
+            expect_probe(test, "no probe " + to_string(i + 1));
+        }
+        test.execute(Tick(INTVL));
+        test.execute(ExpectOneSegment{}.with_rst(true), "dead peer didn't reset the connection");
+        test.execute(ExpectState{State::RESET});
+    }
+
+    // data in flight is retransmitted, not probed for
+    {
+        TCPTestHarness test = TCPTestHarness::in_established(keepalive_config());
+        test.execute(Write{"hello"});
+        test.execute(ExpectOneSegment{}.with_data("hello"));
+        if (test._fsm.idle() or test._fsm.keepalive_due().has_value()) {
+            throw runtime_error("connection with data in flight is idle");
+        }
+        test.execute(Tick(IDLE));
+        test.execute(ExpectSegment{}.with_data("hello"), "expected a retransmission");
+    }
+
+    // a probe is answered with an ACK
+    {
+        TCPTestHarness test = TCPTestHarness::in_established(TCPConfig{});
+        test.send_ack(WrappingInt32{0}, WrappingInt32{1});
+        test.execute(ExpectOneSegment{}.with_no_flags().with_ack(true).with_ackno(1).with_payload_size(0),
+                     "probe wasn't answered with an ACK");
+    }
+
+    // without keepalive, an idle connection stays quiet forever
+    {
+        TCPTestHarness test = TCPTestHarness::in_established(TCPConfig{});
+        test.execute(Tick(100 * IDLE));
+        test.execute(ExpectNoSegment{}, "idle connection sent something without keepalive");
+        if (not test._fsm.active() or test._fsm.keepalive_due().has_value()) {
+            throw runtime_error("idle connection without keepalive changed");
+        }
+    }
+}
+
+const Address SERVER{"10.0.0.1", 80};
+constexpr uint16_t FIRST_PORT = 10000;
+
+static void test_listener() {
+    const size_t peers = 40;
+    TCPListener listener(keepalive_config(), SERVER);
+    deque<TCPTestClient> clients;
+    for (size_t i = 0; i < peers; i++) {
+        clients.emplace_back(FIRST_PORT + i, SERVER);
+        clients.back().conn.connect();
+    }
+    exchange(listener, clients, FIRST_PORT);
+    while (listener.accept().has_value()) {
+    }
+
+    // established and idle, the connections aren't ticked...
+    if (listener.connections() != peers or listener.busy_connections() != 0) {
+        throw runtime_error(to_string(listener.busy_connections()) + " idle connections still ticked");
+    }
+    listener.tick(IDLE - 1);
+    if (exchange(listener, clients, FIRST_PORT).datagrams != 0 or listener.busy_connections() != 0) {
+        throw runtime_error("idle connections did something before their keepalive was due");
+    }
+
+    // ...until their keepalive is due; the peers' answers send them back to sleep
+    listener.tick(1);
+    if (exchange(listener, clients, FIRST_PORT).datagrams != peers or listener.busy_connections() != 0) {
+        throw runtime_error("idle connections weren't probed");
+    }
+
+    // the owner using a connection wakes it
+    const FourTuple first{SERVER.ipv4_numeric(), SERVER.port(), clients[0].adapter.config().source.ipv4_numeric(),
+                          FIRST_PORT};
+    listener.connection(first)->write("hello");
+    if (listener.busy_connections() != 1) {
+        throw runtime_error("connection the owner used wasn't woken");
+    }
+    listener.tick(1);
+    exchange(listener, clients, FIRST_PORT);
+    if (clients[0].conn.inbound_stream().read(100) != "hello" or listener.busy_connections() != 0) {
+        throw runtime_error("woken connection didn't send, or didn't go back to sleep");
+    }
+
+    // half the peers go away: their connections are probed, reset and forgotten, and the rest stay
+    for (size_t i = 0; i < peers; i += 2) {
+        clients[i].alive = false;
+    }
+    for (size_t elapsed = 0; elapsed < IDLE + PROBES * INTVL + 1000; elapsed += 10) {
+        listener.tick(10);
+        exchange(listener, clients, FIRST_PORT);
+    }
+    if (listener.connections() != peers / 2 or listener.busy_connections() != 0) {
+        throw runtime_error(to_string(listener.connections()) + " connections left, expected " +
+                            to_string(peers / 2));
+    }
+    for (size_t i = 1; i < peers; i += 2) {
+        if (not clients[i].conn.active()) {
+            throw runtime_error("live peer's connection was reset");
+        }
+    }
+
+    // a connection woken after a long sleep is caught up first, so its new data isn't taken to be long overdue
+    {
+        TCPListener quiet_listener(TCPConfig{}, SERVER);
+        deque<TCPTestClient> quiet_clients;
+        quiet_clients.emplace_back(FIRST_PORT, SERVER);
+        quiet_clients.back().conn.connect();
+        exchange(quiet_listener, quiet_clients, FIRST_PORT);
+        const optional<FourTuple> tuple = quiet_listener.accept();
+        quiet_listener.tick(100 * 1000);
+        if (not tuple.has_value() or quiet_listener.busy_connections() != 0) {
+            throw runtime_error("quiet connection wasn't parked");
+        }
+
+        quiet_listener.connection(tuple.value())->write("x");
+        quiet_listener.flush(tuple.value());
+        if (quiet_listener.datagrams_out().size() != 1) {
+            throw runtime_error("woken connection didn't send its data");
+        }
+        quiet_listener.datagrams_out().pop();
+        quiet_listener.tick(1);
+        if (not quiet_listener.datagrams_out().empty()) {
+            throw runtime_error("woken connection retransmitted right away");
+        }
+    }
+}
+
+int main() {
+    try {
+        test_connection();
+        test_listener();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
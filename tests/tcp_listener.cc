@@ -0,0 +1,121 @@
+#include "address.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_listener.hh"
+#include "tcp_listener_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+const Address SERVER{"10.0.0.1", 80};
+
+static void test_backlog() {
+    TCPListener listener(TCPConfig{}, SERVER, 2, 3);
+    deque<TCPTestClient> clients;
+    for (uint16_t i = 0; i < 3; i++) {
+        clients.emplace_back(10000 + i, SERVER);
+        clients.back().conn.connect();
+    }
+    exchange(listener, clients, 10000);
+
+    // two handshakes complete; the third's final ACK finds the accept queue full
+    if (listener.accept_queue_length() != 2 or listener.syn_queue_length() != 1 or
+        listener.stats().accept_queue_drops != 1) {
+        throw runtime_error("backlog of 2 wasn't kept");
+    }
+
+    // a fourth SYN is turned away too, for now
+    clients.emplace_back(10003, SERVER);
+    clients.back().conn.connect();
+    exchange(listener, clients, 10000);
+    if (listener.connections() != 3 or listener.stats().accept_queue_drops != 2) {
+        throw runtime_error("SYN accepted with the accept queue full");
+    }
+
+    // once the owner accepts one, the third handshake completes when the SYN/ACK is resent
+    const optional<FourTuple> first = listener.accept();
+    if (not first.has_value() or first->remote_port != 10000 or first->local_port != 80) {
+        throw runtime_error("accept() didn't return the first connection");
+    }
+    listener.tick(TCPConfig::TIMEOUT_DFLT);
+    exchange(listener, clients, 10000);
+    if (listener.accept_queue_length() != 2 or listener.syn_queue_length() != 0) {
+        throw runtime_error("handshake didn't complete once there was room");
+    }
+
+    // data goes to the right connection, and back
+    clients[0].conn.write("hello");
+    exchange(listener, clients, 10000);
+    TCPConnection *server = listener.connection(first.value());
+    if (server == nullptr or server->inbound_stream().read(100) != "hello") {
+        throw runtime_error("data didn't reach the accepted connection");
+    }
+    server->write("world");
+    listener.flush(first.value());
+    exchange(listener, clients, 10000);
+    if (clients[0].conn.inbound_stream().read(100) != "world" or
+        not clients[1].conn.inbound_stream().buffer_empty()) {
+        throw runtime_error("reply didn't reach its client (only)");
+    }
+
+    // both sides close, and once the connection has finished, the listener forgets it
+    clients[0].conn.end_input_stream();
+    server->end_input_stream();
+    listener.flush(first.value());
+    exchange(listener, clients, 10000);
+    for (int i = 0; i < 20 and listener.connection(first.value()) != nullptr; i++) {
+        listener.tick(TCPConfig::TIMEOUT_DFLT);
+        exchange(listener, clients, 10000);
+    }
+    if (listener.connection(first.value()) != nullptr) {
+        throw runtime_error("finished connection wasn't forgotten");
+    }
+}
+
+static void test_many_peers() {
+    const size_t peers = 100;
+    TCPListener listener(TCPConfig{}, Address("0", 80), peers, peers);
+    deque<TCPTestClient> clients;
+    for (size_t i = 0; i < peers; i++) {
+        clients.emplace_back(20000 + i, SERVER);
+        clients.back().conn.connect();
+    }
+    exchange(listener, clients, 20000);
+    size_t accepted = 0;
+    while (listener.accept().has_value()) {
+        accepted++;
+    }
+    if (accepted != peers or listener.connections() != peers) {
+        throw runtime_error("only " + to_string(accepted) + " of " + to_string(peers) + " peers accepted");
+    }
+
+    // a segment for no connection gets a RST
+    deque<TCPTestClient> stranger;
+    stranger.emplace_back(30000, SERVER);
+    TCPSegment ack;
+    ack.header().ack = true;
+    ack.header().ackno = WrappingInt32{12345};
+    stranger.back().conn.segments_out().push(ack);
+    if (exchange(listener, stranger, 30000).resets != 1 or listener.stats().unmatched != 1) {
+        throw runtime_error("segment for no connection wasn't reset");
+    }
+}
+
+int main() {
+    try {
+        test_backlog();
+        test_many_peers();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,71 @@
+#include "tcp_listener_test_harness.hh"
+
+#include "tcp_segment.hh"
+
+#include <optional>
+#include <stdexcept>
+
+using namespace std;
+
+TCPTestClient::TCPTestClient(const uint16_t port, const Address &server, const TCPConfig &cfg) : conn(cfg) {
+    adapter.config_mut().source = {"10.0.0.2", port};
+    adapter.config_mut().destination = server;
+}
+
+InternetDatagram reparse(const InternetDatagram &dgram) {
+    InternetDatagram parsed;
+    if (parsed.parse(dgram.serialize().concatenate()) != ParseResult::NoError) {
+        throw runtime_error("datagram doesn't parse");
+    }
+    return parsed;
+}
+
+size_t to_listener(TCPListener &listener, TCPTestClient &client) {
+    size_t sent = 0;
+    while (client.alive and not client.conn.segments_out().empty()) {
+        listener.datagram_received(reparse(client.adapter.wrap_tcp_in_ip(client.conn.segments_out().front())));
+        client.conn.segments_out().pop();
+        sent++;
+    }
+    return sent;
+}
+
+TCPExchangeResult to_clients(TCPListener &listener, deque<TCPTestClient> &clients, const uint16_t first_port) {
+    TCPExchangeResult result;
+    while (not listener.datagrams_out().empty()) {
+        const InternetDatagram dgram = reparse(listener.datagrams_out().front());
+        listener.datagrams_out().pop();
+
+        TCPSegment seg;
+        if (seg.parse(dgram.payload(), dgram.header().pseudo_cksum()) != ParseResult::NoError) {
+            throw runtime_error("listener sent a bad segment");
+        }
+        result.datagrams++;
+        result.resets += seg.header().rst;
+
+        const size_t index = seg.header().dport - first_port;
+        if (index >= clients.size() or not clients[index].alive) {
+            continue;
+        }
+        const optional<TCPSegment> unwrapped = clients[index].adapter.unwrap_tcp_in_ip(dgram);
+        if (unwrapped.has_value()) {
+            clients[index].conn.segment_received(unwrapped.value());
+        }
+    }
+    return result;
+}
+
+TCPExchangeResult exchange(TCPListener &listener, deque<TCPTestClient> &clients, const uint16_t first_port) {
+    TCPExchangeResult result;
+    for (bool quiet = false; not quiet;) {
+        size_t sent = 0;
+        for (auto &client : clients) {
+            sent += to_listener(listener, client);
+        }
+        const TCPExchangeResult received = to_clients(listener, clients, first_port);
+        result.datagrams += received.datagrams;
+        result.resets += received.resets;
+        quiet = sent == 0 and received.datagrams == 0;
+    }
+    return result;
+}
@@ -0,0 +1,45 @@
+#ifndef SPONGE_TESTS_TCP_LISTENER_TEST_HARNESS_HH
+#define SPONGE_TESTS_TCP_LISTENER_TEST_HARNESS_HH
+
+#include "address.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_listener.hh"
+#include "tcp_over_ip.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+//! A peer of the TCPListener under test: a connection of its own, and the adapter that puts its segments in datagrams
+struct TCPTestClient {
+    TCPConnection conn;            //!< The peer's end of the connection
+    TCPOverIPv4Adapter adapter{};  //!< Wraps its segments for the listener, and unwraps the listener's
+    bool alive{true};              //!< A peer that has gone away neither sends nor receives
+
+    //! A client at 10.0.0.2:`port`, talking to `server`
+    TCPTestClient(const uint16_t port, const Address &server, const TCPConfig &cfg = {});
+};
+
+//! What the listener sent during an exchange()
+struct TCPExchangeResult {
+    size_t datagrams{0};  //!< Datagrams sent
+    size_t resets{0};     //!< Of which, RSTs
+};
+
+//! Parse `dgram` from its serialization, as whoever it's sent to would
+InternetDatagram reparse(const InternetDatagram &dgram);
+
+//! Hand the segments `client` has to send to `listener`, if it's alive, returning how many there were
+size_t to_listener(TCPListener &listener, TCPTestClient &client);
+
+//! \brief Hand the datagrams `listener` has to send to the clients they're for, if alive, returning what was sent
+//! \details The listener's datagrams for port `first_port + i` go to `clients[i]`; any for other ports are dropped.
+TCPExchangeResult to_clients(TCPListener &listener, std::deque<TCPTestClient> &clients, const uint16_t first_port);
+
+//! \brief Carry datagrams between `listener` and the clients that are alive, until there are none left
+//! \details The listener's datagrams for port `first_port + i` go to `clients[i]`; any for other ports are dropped.
+TCPExchangeResult exchange(TCPListener &listener, std::deque<TCPTestClient> &clients, const uint16_t first_port);
+
+#endif  // SPONGE_TESTS_TCP_LISTENER_TEST_HARNESS_HH
@@ -0,0 +1,89 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+constexpr uint16_t WINDOW = 65000;
+
+static TCPConfig nagle_config(const bool nagle) {
+    TCPConfig cfg{};
+    cfg.nagle = nagle;
+    return cfg;
+}
+
+int main() {
+    try {
+        const size_t mss = TCPConfig::MAX_PAYLOAD_SIZE;
+
+        // Nagle: small writes wait for the ACK of what's in flight, then go as one segment
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(nagle_config(true), WINDOW);
+            test.execute(Write{"a"});
+            test.execute(ExpectOneSegment{}.with_data("a"), "first small write wasn't sent");
+            test.execute(Write{"b"});
+            test.execute(Write{"c"});
+            test.execute(ExpectNoSegment{}, "small writes were sent with data in flight");
+            test.send_ack(WrappingInt32{1}, WrappingInt32{2}, WINDOW);
+            test.execute(ExpectOneSegment{}.with_data("bc"), "held writes didn't go as one on the ACK");
+
+            // a full segment's worth goes right away; only the remainder waits
+            test.execute(Write{string(mss + 10, 'x')});
+            test.execute(ExpectOneSegment{}.with_data(string(mss, 'x')), "full segment was held back");
+            test.send_ack(WrappingInt32{1}, WrappingInt32{uint32_t(4 + mss)}, WINDOW);
+            test.execute(ExpectOneSegment{}.with_data(string(10, 'x')), "remainder wasn't sent on the ACK");
+
+            // ending the stream sends whatever is held, with the FIN
+            test.execute(Write{"de"});
+            test.execute(ExpectNoSegment{}, "small write before the end was sent");
+            test.execute(Close{});
+            test.execute(ExpectOneSegment{}.with_fin(true).with_data("de"), "held data didn't go out with the FIN");
+        }
+
+        // without Nagle, every write is sent at once
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(nagle_config(false), WINDOW);
+            test.execute(Write{"a"});
+            test.execute(ExpectOneSegment{}.with_data("a"), "first write wasn't sent without Nagle");
+            test.execute(Write{"b"});
+            test.execute(ExpectOneSegment{}.with_data("b"), "second write wasn't sent without Nagle");
+        }
+
+        // corked: writes coalesce until uncork, even with nothing in flight
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(nagle_config(false), WINDOW);
+            test.execute(Cork{});
+            test.execute(Write{"GET "});
+            test.execute(Write{"/ "});
+            test.execute(Write{"HTTP/1.1"});
+            test.execute(ExpectNoSegment{}, "corked writes were sent");
+            test.execute(Uncork{});
+            test.execute(ExpectOneSegment{}.with_data("GET / HTTP/1.1"), "corked writes didn't go as one");
+            test.execute(Write{"z"});
+            test.execute(ExpectOneSegment{}.with_data("z"), "write after uncork wasn't sent");
+
+            // full segments aren't held back
+            test.execute(Cork{});
+            test.execute(Write{string(mss + 1, 'y')});
+            test.execute(ExpectOneSegment{}.with_data(string(mss, 'y')), "corked full segment was held back");
+
+            // and the rest isn't held forever
+            test.execute(Tick(TCPConfig::CORK_TIMEOUT_DFLT - 1));
+            test.execute(ExpectNoSegment{}, "corked remainder was sent before the time limit");
+            test.execute(Tick(1));
+            test.execute(ExpectOneSegment{}.with_data("y"), "corked remainder wasn't sent at the time limit");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,159 @@
+#include "address.hh"
+#include "fd_adapter.hh"
+#include "ipv4_header.hh"
+#include "socket.hh"
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_header.hh"
+#include "tcp_sponge_socket.hh"
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// write `data`, and return when each segment sent departs; departure times don't go on the wire, so they're read
+// off the connection before the harness takes its segments
+static vector<uint64_t> write_departures(TCPTestHarness &test, const string &data) {
+    test._fsm.write(data);
+    vector<uint64_t> times;
+    while (not test._fsm.segments_out().empty()) {
+        times.push_back(test._fsm.segments_out().front().departure());
+        test._fsm.segments_out().pop();
+    }
+    return times;
+}
+
+constexpr uint16_t WINDOW = 65000;
+
+static TCPConfig pacing_config(const uint64_t pacing_rate) {
+    TCPConfig cfg{};
+    cfg.pacing_rate = pacing_rate;
+    return cfg;
+}
+
+int main() {
+    try {
+        const size_t mss = TCPConfig::MAX_PAYLOAD_SIZE;
+        const uint64_t wire_size = mss + IPv4Header::LENGTH + TCPHeader::LENGTH;
+
+        // a window's worth of data leaves one segment per wire_size / rate, rather than all at once
+        {
+            const uint64_t rate = 1000000;  // 1 MB/s: a microsecond per byte
+            TCPTestHarness test = TCPTestHarness::in_established(pacing_config(rate), WINDOW);
+            const uint64_t start = test._fsm.clock();
+            const vector<uint64_t> times = write_departures(test, string(5 * mss, 'x'));
+            if (times.size() != 5) {
+                throw runtime_error("expected 5 segments");
+            }
+            for (size_t i = 0; i < times.size(); i++) {
+                if (times[i] < start + i * wire_size or times[i] > start + (i + 1) * wire_size) {
+                    throw runtime_error("segment " + to_string(i) + " departs at " + to_string(times[i]) +
+                                        " us, not paced at " + to_string(rate) + " B/s");
+                }
+            }
+            for (size_t i = 1; i < times.size(); i++) {
+                if (times[i] - times[i - 1] != wire_size) {
+                    throw runtime_error("segments aren't evenly spaced");
+                }
+            }
+
+            // after a while idle, the next segment leaves now, with no credit built up for a burst
+            test.send_ack(WrappingInt32{1}, WrappingInt32{uint32_t(1 + 5 * mss)}, WINDOW);
+            test.execute(Tick(1000));
+            const vector<uint64_t> later = write_departures(test, string(2 * mss, 'y'));
+            if (later.size() != 2 or later[0] != test._fsm.clock() or later[1] != test._fsm.clock() + wire_size) {
+                throw runtime_error("idle connection burst to catch up");
+            }
+
+            // congestion control may change the rate
+            test.send_ack(WrappingInt32{1}, WrappingInt32{uint32_t(1 + 7 * mss)}, WINDOW);
+            test._fsm.set_pacing_rate(2 * rate);
+            test.execute(Tick(1000));
+            const vector<uint64_t> faster = write_departures(test, string(2 * mss, 'z'));
+            if (faster.size() != 2 or faster[1] - faster[0] != wire_size / 2) {
+                throw runtime_error("new pacing rate wasn't used");
+            }
+        }
+
+        // without pacing, every segment may leave at once
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(pacing_config(0), WINDOW);
+            test.execute(Tick(500));
+            for (const uint64_t departure : write_departures(test, string(3 * mss, 'x'))) {
+                if (departure != 0) {
+                    throw runtime_error("unpaced segment was given a departure time");
+                }
+            }
+        }
+
+        // over a real socket, the event loop holds each paced segment until its departure time, then sends it
+        {
+            const uint64_t rate = 100000;  // 100 kB/s: a segment every ~10 ms
+            const size_t total = 10 * mss;
+            // a short timeout, so neither end lingers long once closed
+            TCPConfig cfg = pacing_config(rate);
+            cfg.rt_timeout = 50;
+            TCPConfig server_cfg = pacing_config(0);
+            server_cfg.rt_timeout = 50;
+
+            UDPSocket server_udp;
+            server_udp.bind(Address("127.0.0.1", 0));
+            FdAdapterConfig server_ad{};
+            server_ad.source = server_udp.local_address();
+            FdAdapterConfig client_ad{};
+            client_ad.destination = server_ad.source;
+
+            // the server reads everything, and notes when the last of it arrived
+            TCPOverUDPSpongeSocket server{TCPOverUDPSocketAdapter{move(server_udp)}};
+            uint64_t last_arrival = 0;
+            exception_ptr server_error;
+            thread server_thread([&] {
+                try {
+                    server.listen_and_accept(server_cfg, server_ad);
+                    for (size_t received = 0; received < total;) {
+                        received += server.read().size();
+                    }
+                    last_arrival = timestamp_ms();
+                    server.wait_until_closed();
+                } catch (...) {
+                    server_error = current_exception();
+                }
+            });
+
+            TCPOverUDPSpongeSocket client{TCPOverUDPSocketAdapter{UDPSocket{}}};
+            client.connect(cfg, client_ad);
+            const uint64_t written = timestamp_ms();
+            client.write(string(total, 'x'));
+            client.wait_until_closed();
+            server_thread.join();
+            if (server_error) {
+                rethrow_exception(server_error);
+            }
+
+            // the last segment departs 9 segments' time after the first, less the up to 10 ms the connection's
+            // clock (ticked by the loop) may lag behind
+            const uint64_t paced_ms = 9 * wire_size * 1000 / rate - 10;
+            if (last_arrival - written < paced_ms) {
+                throw runtime_error("socket sent " + to_string(total) + " bytes in " +
+                                    to_string(last_arrival - written) + " ms, faster than their pacing allows (" +
+                                    to_string(paced_ms) + " ms)");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -116,6 +116,23 @@ int main(int argc, char **argv) {
                     throw runtime_error("bad parse: got wrong error for segment shorter than 20 bytes");
                 }
             }
+
+            // a short segment that doesn't even hold a valid `doff` counts as a header that's too short
+            test_header[12] = 0x40;
+            {
+                NetParser p{string(test_header.begin(), test_header.end())};
+                if (const auto res = test_1.parse(p); res != ParseResult::HeaderTooShort) {
+                    throw runtime_error("bad parse: got wrong error for short segment with bad doff value");
+                }
+            }
+
+            test_header.resize(12);
+            {
+                NetParser p{string(test_header.begin(), test_header.end())};
+                if (const auto res = test_1.parse(p); res != ParseResult::HeaderTooShort) {
+                    throw runtime_error("bad parse: got wrong error for segment cut off before doff");
+                }
+            }
         }
 
         // now process some segments off the wire for correctness of parser and unparser
@@ -137,6 +154,7 @@ int main(int argc, char **argv) {
         }
 
         bool ok = true;
+        vector<Buffer> parsed_segments;
         const uint8_t *pkt;
         struct pcap_pkthdr hdr;
         while ((pkt = pcap_next(pcap, &hdr)) != nullptr) {
@@ -185,6 +203,8 @@ int main(int argc, char **argv) {
                 continue;
             }
 
+            parsed_segments.emplace_back(string(tcp_seg_data, tcp_seg_data + tcp_seg_len));
+
             // parse succeeded. Create a new segment and rebuild the header by unparsing.
             cout << dec;
 
@@ -204,6 +224,17 @@ int main(int argc, char **argv) {
                 cout << "ERROR: after unparsing, TCP headers (other than length) don't match.\n";
             }
 
+            // serializing into headroom must produce the same bytes as serialize()
+            {
+                Headroom room;
+                tcp_seg_copy.serialize_into(room);
+                if (string(room.str()) + tcp_seg_copy.payload().copy() != tcp_seg_copy.serialize().concatenate()) {
+                    cout << "ERROR: serialize_into() doesn't match serialize().\n";
+                    ok = false;
+                    continue;
+                }
+            }
+
             TCPSegment tcp_seg_copy2;
             if (const auto res = tcp_seg_copy2.parse(tcp_seg_copy.serialize().concatenate());
                 res != ParseResult::NoError) {
@@ -236,6 +267,12 @@ int main(int argc, char **argv) {
         if (!ok) {
             return EXIT_FAILURE;
         }
+
+        report_parse_throughput("TCP header", parsed_segments, [](const Buffer &segment) {
+            NetParser p{segment};
+            TCPHeader header;
+            return header.parse(p) == ParseResult::NoError;
+        });
     } catch (const exception &e) {
         cout << "Exception: " << e.what() << endl;
         return EXIT_FAILURE;
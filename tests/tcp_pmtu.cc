@@ -0,0 +1,272 @@
+#include "icmp_message.hh"
+#include "ipv4_datagram.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_over_ip.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+static TCPConfig make_config(const size_t mss, const size_t mss_probe_limit) {
+    TCPConfig cfg{};
+    cfg.mss = mss;
+    cfg.mss_probe_limit = mss_probe_limit;
+    return cfg;
+}
+
+// The far end of a path that drops segments carrying more than `path_mss` bytes. It takes the segments straight
+// from the connection, as they may be larger than the harness carries.
+class Peer {
+    size_t _path_mss;
+    uint64_t _received{0};           //!< Bytes received in order
+    map<uint64_t, size_t> _early{};  //!< Segments received out of order: start and size
+    size_t _largest{0};              //!< Largest payload that got through
+
+  public:
+    explicit Peer(const size_t path_mss) : _path_mss(path_mss) {}
+
+    // take what the connection sent, and acknowledge it if anything got through
+    bool receive(TCPConnection &conn) {
+        bool got_through = false;
+        while (not conn.segments_out().empty()) {
+            const TCPSegment seg = move(conn.segments_out().front());
+            conn.segments_out().pop();
+            const size_t size = seg.payload().size();
+            if (size == 0 or size > _path_mss) {
+                continue;
+            }
+            got_through = true;
+            _largest = max(_largest, size);
+            _early.emplace(seg.header().seqno.raw_value() - 1, size);
+            while (not _early.empty() and _early.begin()->first <= _received) {
+                _received = max<uint64_t>(_received, _early.begin()->first + _early.begin()->second);
+                _early.erase(_early.begin());
+            }
+        }
+        if (got_through) {
+            TCPSegment ack;
+            ack.header().ack = true;
+            ack.header().seqno = WrappingInt32{1};
+            ack.header().ackno = WrappingInt32{uint32_t(1 + _received)};
+            ack.header().win = 65000;
+            conn.segment_received(ack);
+        }
+        return got_through;
+    }
+
+    uint64_t received() const { return _received; }
+    size_t largest() const { return _largest; }
+};
+
+// write `total` bytes, and keep the connection going until the peer has acknowledged everything written
+static void transfer(TCPConnection &conn, Peer &peer, const TCPConfig &cfg, const size_t total) {
+    size_t written = 0;
+    for (size_t round = 0;
+         written < total or conn.bytes_in_flight() > 0 or conn.remaining_outbound_capacity() < cfg.send_capacity;
+         round++) {
+        if (round > 10000 or not conn.active()) {
+            throw runtime_error("transfer didn't finish (" + to_string(peer.received()) + " bytes arrived)");
+        }
+        if (written < total) {
+            written += conn.write(string(total - written, 'x'));
+        }
+        if (not peer.receive(conn)) {
+            conn.tick(cfg.rt_timeout * 4);
+        }
+    }
+}
+
+static void test_probe_up() {
+    const TCPConfig cfg = make_config(1000, 1460);
+    TCPTestHarness test = TCPTestHarness::in_established(cfg, 65000);
+    TCPConnection &conn = test._fsm;
+    Peer peer{1460};
+    transfer(conn, peer, cfg, 100000);
+    if (conn.mss() != 1460 or peer.largest() != 1460) {
+        throw runtime_error("probing didn't raise the MSS to 1460 (got " + to_string(conn.mss()) + ")");
+    }
+}
+
+static void test_probe_loss() {
+    const TCPConfig cfg = make_config(1000, 1460);
+    TCPTestHarness test = TCPTestHarness::in_established(cfg, 65000);
+    TCPConnection &conn = test._fsm;
+    Peer peer{1160};
+    transfer(conn, peer, cfg, 300000);
+    if (conn.mss() <= 1000 or conn.mss() > 1160) {
+        throw runtime_error("probing settled on an MSS of " + to_string(conn.mss()) + " on a path carrying 1160");
+    }
+
+    // probing stops once it's close enough
+    const size_t mss = conn.mss();
+    transfer(conn, peer, cfg, 100000);
+    if (conn.mss() != mss) {
+        throw runtime_error("MSS moved after probing stopped");
+    }
+}
+
+// pops what the connection sent, returning each segment's seqno and size
+static vector<pair<uint32_t, size_t>> take_sent(TCPConnection &conn) {
+    vector<pair<uint32_t, size_t>> sent;
+    while (not conn.segments_out().empty()) {
+        sent.emplace_back(conn.segments_out().front().header().seqno.raw_value(),
+                          conn.segments_out().front().payload().size());
+        conn.segments_out().pop();
+    }
+    return sent;
+}
+
+static void test_probe_loss_isnt_congestion() {
+    const TCPConfig cfg = make_config(1000, 1460);
+    TCPTestHarness test = TCPTestHarness::in_established(cfg, 65000);
+    TCPConnection &conn = test._fsm;
+
+    // the first full segment is a probe, which the path drops
+    conn.write(string(1460, 'x'));
+    if (take_sent(conn) != vector<pair<uint32_t, size_t>>{{1, 1460}}) {
+        throw runtime_error("expected a probe of 1460 bytes");
+    }
+
+    // when it times out, all its data goes again in segments of the current size...
+    conn.tick(cfg.rt_timeout);
+    if (take_sent(conn) != vector<pair<uint32_t, size_t>>{{1, 1000}, {1001, 460}}) {
+        throw runtime_error("a lost probe's data wasn't all resent at the current MSS");
+    }
+
+    // ...and the timer doesn't back off, as it would had the loss been congestion
+    conn.tick(cfg.rt_timeout - 1);
+    if (not conn.segments_out().empty()) {
+        throw runtime_error("retransmitted before the timeout");
+    }
+    conn.tick(1);
+    if (take_sent(conn) != vector<pair<uint32_t, size_t>>{{1, 1000}}) {
+        throw runtime_error("the timeout doubled after a lost probe");
+    }
+}
+
+static void test_icmp_report() {
+    const TCPConfig cfg = make_config(1460, 1460);
+    TCPTestHarness test = TCPTestHarness::in_established(cfg, 65000);
+    TCPConnection &conn = test._fsm;
+    Peer peer{1160};
+
+    // everything in the first flight is too big for the path...
+    conn.write(string(10000, 'x'));
+    if (peer.receive(conn)) {
+        throw runtime_error("segments larger than the path MTU got through");
+    }
+
+    // ...which a router says, so the data goes again, in segments that fit
+    conn.path_mtu_reported(1200);
+    if (conn.mss() != 1160) {
+        throw runtime_error("MSS is " + to_string(conn.mss()) + " after an ICMP report of MTU 1200");
+    }
+    if (conn.segments_out().empty() or conn.segments_out().front().payload().size() != 1160 or
+        conn.segments_out().front().header().seqno != WrappingInt32{1}) {
+        throw runtime_error("the oldest segment wasn't resent at the new MSS right away");
+    }
+    transfer(conn, peer, cfg, 0);
+    if (peer.received() != 10000) {
+        throw runtime_error("data lost after the MSS was lowered");
+    }
+
+    // with nothing in flight too big, a report doesn't resend anything
+    conn.write(string(500, 'x'));
+    take_sent(conn);
+    conn.path_mtu_reported(1100);
+    if (conn.mss() != 1060 or not conn.segments_out().empty()) {
+        throw runtime_error("a report resent a segment that fit");
+    }
+    transfer(conn, peer, cfg, 0);
+    if (peer.received() != 10500) {
+        throw runtime_error("data lost after the MSS was lowered");
+    }
+
+    // reports never raise the MSS, nor lower it below what every path carries
+    conn.path_mtu_reported(9000);
+    if (conn.mss() != 1060) {
+        throw runtime_error("an ICMP report raised the MSS");
+    }
+    conn.path_mtu_reported(300);
+    if (conn.mss() != TCPConfig::MIN_PAYLOAD_SIZE) {
+        throw runtime_error("an ICMP report lowered the MSS below the minimum");
+    }
+}
+
+static InternetDatagram make_icmp(const InternetDatagram &quoted, const uint16_t mtu, const uint32_t to) {
+    ICMPMessage icmp;
+    icmp.type = ICMPMessage::TYPE_DESTINATION_UNREACHABLE;
+    icmp.code = ICMPMessage::CODE_FRAGMENTATION_NEEDED;
+    icmp.rest_of_header = mtu;
+    icmp.original = quoted.serialize().concatenate().substr(0, 4 * quoted.header().hlen + 8);
+
+    InternetDatagram dgram;
+    dgram.header().src = (10u << 24) | (9 << 16) | (9 << 8) | 9;  // a router on the path
+    dgram.header().dst = to;
+    dgram.header().proto = IPv4Header::PROTO_ICMP;
+    dgram.payload() = icmp.serialize();
+    dgram.header().len = 4 * dgram.header().hlen + dgram.payload().size();
+
+    InternetDatagram parsed;
+    if (parsed.parse(dgram.serialize().concatenate()) != ParseResult::NoError) {
+        throw runtime_error("ICMP datagram doesn't parse");
+    }
+    return parsed;
+}
+
+static void test_adapter() {
+    TCPOverIPv4Adapter adapter;
+    adapter.config_mut().source = {"10.0.0.1", 1234};
+    adapter.config_mut().destination = {"10.0.0.2", 80};
+
+    TCPSegment seg;
+    seg.payload() = string(100, 'x');
+    const InternetDatagram sent = adapter.wrap_tcp_in_ip(seg);
+    if (not sent.header().df) {
+        throw runtime_error("segment sent without DF set");
+    }
+
+    // a report quoting one of our segments is passed on
+    if (adapter.unwrap_tcp_in_ip(make_icmp(sent, 1200, sent.header().src)).has_value() or
+        adapter.take_path_mtu_report() != 1200 or adapter.take_path_mtu_report().has_value()) {
+        throw runtime_error("ICMP fragmentation needed wasn't reported once");
+    }
+
+    // one quoting some other connection's isn't
+    InternetDatagram other = sent;
+    TCPSegment other_seg;
+    other_seg.payload() = string(100, 'y');
+    other_seg.header().sport = 4321;
+    other_seg.header().dport = 80;
+    other.payload() = other_seg.serialize(other.header().pseudo_cksum());
+    adapter.unwrap_tcp_in_ip(make_icmp(other, 1200, sent.header().src));
+    if (adapter.take_path_mtu_report().has_value()) {
+        throw runtime_error("ICMP about another connection was reported");
+    }
+}
+
+int main() {
+    try {
+        test_probe_up();
+        test_probe_loss();
+        test_probe_loss_isnt_congestion();
+        test_icmp_report();
+        test_adapter();
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+constexpr size_t RTT_MS = 10;
+
+// the far end, sending as much as the connection's window allows, once per RTT
+class Peer {
+    uint64_t _sent{0};     //!< Stream bytes sent
+    uint64_t _edge{0};     //!< The furthest stream index the connection's window has reached
+    uint16_t _window{0};   //!< The last window the connection advertised
+    size_t _open{0};       //!< The window it had open at the start of the last round, by its answer to the probe
+
+  public:
+    // read the connection's ACKs, checking that its window never moves back
+    void take_acks(TCPTestHarness &test) {
+        while (test.can_read()) {
+            const TCPSegment seg = test.expect_seg(ExpectSegment{}.with_ack(true).with_payload_size(0));
+            const uint64_t ackno = seg.header().ackno.raw_value() - 1;
+            if (ackno + seg.header().win < _edge) {
+                throw runtime_error("the window's right edge moved back");
+            }
+            _edge = ackno + seg.header().win;
+            _window = seg.header().win;
+        }
+    }
+
+    void send_segment(TCPTestHarness &test, const size_t size) {
+        test.execute(SendSegment{}
+                         .with_ack(true)
+                         .with_ackno(1)
+                         .with_win(65000)
+                         .with_seqno(uint32_t(1 + _sent))
+                         .with_data(string(size, 'x')));
+        take_acks(test);
+        _sent = max(_sent, min(_sent + size, _edge));
+    }
+
+    // send what the window allows, in segments of up to 1000 bytes, probing it first if it was closed (or, in the
+    // first round, not yet seen)
+    void send(TCPTestHarness &test) {
+        if (_sent == _edge) {
+            send_segment(test, 1);
+            _open = _window + 1;
+        }
+        while (_sent < _edge) {
+            send_segment(test, min<uint64_t>(1000, _edge - _sent));
+        }
+    }
+
+    size_t open_window() const { return _open; }
+};
+
+static TCPConfig tuning_config(const size_t capacity, const size_t capacity_max) {
+    TCPConfig cfg{};
+    cfg.recv_capacity = capacity;
+    cfg.recv_capacity_max = capacity_max;
+    return cfg;
+}
+
+// one RTT: the peer fills the window, and the reader reads `read` bytes at most
+static void round_trip(TCPTestHarness &test, Peer &peer, const size_t read) {
+    peer.send(test);
+    test._fsm.inbound_stream().pop_output(read);
+    test.execute(Tick(RTT_MS));
+    peer.take_acks(test);
+}
+
+int main() {
+    try {
+        // a reader that keeps up lets the buffer grow to the limit
+        {
+            Peer peer;
+            TCPTestHarness test = TCPTestHarness::in_established(tuning_config(4000, 64000));
+            TCPConnection &conn = test._fsm;
+            for (size_t i = 0; i < 40; i++) {
+                round_trip(test, peer, 1000000);
+            }
+            if (conn.receive_capacity() != 64000 or peer.open_window() != 64000) {
+                throw runtime_error("receive buffer grew to " + to_string(conn.receive_capacity()) + ", not 64000");
+            }
+
+            // memory pressure shrinks it back, but only as the reader drains it (and the peer checks that the
+            // window's right edge never moves back)
+            peer.send(test);
+            conn.set_memory_pressure(true);
+            if (conn.receive_capacity() != 64000 or conn.inbound_stream().buffer_size() != 64000) {
+                throw runtime_error("receive buffer shrank below what it holds");
+            }
+            for (size_t i = 0; i < 10; i++) {
+                round_trip(test, peer, 1000000);
+            }
+            if (conn.receive_capacity() != 4000 or peer.open_window() != 4000) {
+                throw runtime_error("receive buffer didn't shrink under memory pressure");
+            }
+
+            // and once the pressure is off, it grows again
+            conn.set_memory_pressure(false);
+            for (size_t i = 0; i < 40; i++) {
+                round_trip(test, peer, 1000000);
+            }
+            if (conn.receive_capacity() != 64000) {
+                throw runtime_error("receive buffer didn't grow again after memory pressure");
+            }
+        }
+
+        // a reader that doesn't keep up doesn't
+        {
+            Peer peer;
+            TCPTestHarness test = TCPTestHarness::in_established(tuning_config(4000, 64000));
+            TCPConnection &conn = test._fsm;
+            for (size_t i = 0; i < 40; i++) {
+                round_trip(test, peer, 100);
+            }
+            if (conn.receive_capacity() != 4000) {
+                throw runtime_error("receive buffer grew for a slow reader");
+            }
+        }
+
+        // without a limit set, the buffer stays as configured
+        {
+            Peer peer;
+            TCPTestHarness test = TCPTestHarness::in_established(tuning_config(4000, 0));
+            TCPConnection &conn = test._fsm;
+            for (size_t i = 0; i < 40; i++) {
+                round_trip(test, peer, 1000000);
+            }
+            if (conn.receive_capacity() != 4000) {
+                throw runtime_error("receive buffer grew without auto-tuning");
+            }
+        }
+
+        // past 65535 bytes, the window a header can carry, the buffer still grows, and the window stays full
+        {
+            Peer peer;
+            TCPTestHarness test = TCPTestHarness::in_established(tuning_config(16000, 256000));
+            TCPConnection &conn = test._fsm;
+            for (size_t i = 0; i < 40; i++) {
+                round_trip(test, peer, 1000000);
+            }
+            if (conn.receive_capacity() <= 65535 or peer.open_window() < 65535) {
+                throw runtime_error("receive buffer didn't grow past the largest window");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,134 @@
+#include "tcp_config.hh"
+#include "tcp_expectation.hh"
+#include "tcp_fsm_test_harness.hh"
+#include "tcp_segment.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+// the `count` segments sent, which must carry `size` bytes each
+static void expect_data(TCPTestHarness &test, const size_t size, const string &what, const size_t count = 1) {
+    for (size_t i = 0; i < count; i++) {
+        test.execute(ExpectSegment{}.with_payload_size(size), what);
+    }
+    test.execute(ExpectNoSegment{}, what);
+}
+
+// the last of the segments sent, which must advertise a window of `window` bytes
+static void expect_window(TCPTestHarness &test, const uint16_t window, const string &what) {
+    TCPSegment seg = test.expect_seg(ExpectSegment{}, what);
+    while (test.can_read()) {
+        seg = test.expect_seg(ExpectSegment{}, what);
+    }
+    if (seg.header().win != window) {
+        throw runtime_error(what + ": advertised a window of " + to_string(seg.header().win) + ", expected " +
+                            to_string(window));
+    }
+}
+
+// a segment of the peer's data, `offset` bytes into its stream
+static void data(TCPTestHarness &test, const size_t offset, const size_t size) {
+    test.execute(SendSegment{}
+                     .with_ack(true)
+                     .with_ackno(1)
+                     .with_win(4000)
+                     .with_seqno(uint32_t(1 + offset))
+                     .with_data(string(size, 'x')));
+}
+
+static TCPConfig sws_config(const bool sws_avoidance) {
+    TCPConfig cfg{};
+    cfg.recv_capacity = 4000;
+    cfg.sws_avoidance = sws_avoidance;
+    return cfg;
+}
+
+int main() {
+    try {
+        const size_t mss = TCPConfig::MAX_PAYLOAD_SIZE;
+
+        // sender: a window that opens a little isn't filled with a little segment...
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(sws_config(true), 4000);
+            test.execute(Write{string(10000, 'x')});
+            expect_data(test, mss, "first window", 4);
+            test.send_ack(WrappingInt32{1}, WrappingInt32{uint32_t(1 + mss)}, 3100);
+            test.execute(ExpectNoSegment{}, "window opened by 100 bytes");
+
+            // ...unless it stays that way past the override timeout
+            test.execute(Tick(TCPConfig::SWS_OVERRIDE_TIMEOUT - 1));
+            test.execute(ExpectNoSegment{}, "before the override timeout");
+            test.execute(Tick(1));
+            expect_data(test, 100, "at the override timeout");
+
+            // a zero window is still probed
+            test.send_ack(WrappingInt32{1}, WrappingInt32{uint32_t(1 + 4 * mss + 100)}, 0);
+            expect_data(test, 1, "zero window");
+        }
+
+        // sender: the last of the data goes once everything is acknowledged
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(sws_config(true), 4000);
+            test.execute(Write{string(mss + 300, 'x')});
+            expect_data(test, mss, "full segment");
+            test.execute(ExpectNoSegment{}, "remainder with data in flight");
+            test.send_ack(WrappingInt32{1}, WrappingInt32{uint32_t(1 + mss)}, 4000);
+            expect_data(test, 300, "remainder with everything acknowledged");
+        }
+
+        // sender, without SWS avoidance: whatever the window allows goes
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(sws_config(false), 4000);
+            test.execute(Write{string(10000, 'x')});
+            expect_data(test, mss, "first window, no SWS avoidance", 4);
+            test.send_ack(WrappingInt32{1}, WrappingInt32{uint32_t(1 + mss)}, 3100);
+            expect_data(test, 100, "window opened by 100 bytes, no SWS avoidance");
+        }
+
+        // receiver: the window opens in steps of at least min(MSS, half the buffer)
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(sws_config(true), 4000);
+            for (size_t i = 0; i < 4; i++) {
+                data(test, i * mss, mss);
+            }
+            expect_window(test, 0, "full buffer");
+
+            test._fsm.inbound_stream().pop_output(100);
+            test.execute(Tick(10));
+            test.execute(ExpectNoSegment{}, "100 bytes read");
+            test._fsm.inbound_stream().pop_output(900);
+            test.execute(Tick(10));
+            expect_window(test, 1000, "window update after 1000 bytes read");
+
+            test._fsm.inbound_stream().pop_output(500);
+            data(test, 4 * mss, mss);
+            expect_window(test, 0, "500 bytes of room");
+        }
+
+        // receiver, without SWS avoidance: every byte of room is advertised
+        {
+            TCPTestHarness test = TCPTestHarness::in_established(sws_config(false), 4000);
+            for (size_t i = 0; i < 4; i++) {
+                data(test, i * mss, mss);
+            }
+            expect_window(test, 0, "full buffer, no SWS avoidance");
+            test._fsm.inbound_stream().pop_output(500);
+            test.execute(Tick(10));
+            test.execute(ExpectNoSegment{}, "500 bytes read, no SWS avoidance");
+            data(test, 4 * mss, 100);
+            expect_window(test, 400, "400 bytes of room, no SWS avoidance");
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
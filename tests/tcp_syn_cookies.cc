@@ -0,0 +1,131 @@
+#include "address.hh"
+#include "tcp_config.hh"
+#include "tcp_connection.hh"
+#include "tcp_listener.hh"
+#include "tcp_listener_test_harness.hh"
+#include "tcp_segment.hh"
+
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <optional>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+const Address SERVER{"10.0.0.1", 80};
+const Address CLIENT{"10.0.0.2", 10000};
+
+static TCPListener cookie_listener(const size_t mss = TCPConfig::MAX_PAYLOAD_SIZE) {
+    TCPConfig cfg{};
+    cfg.syn_cookies = true;
+    cfg.mss = mss;
+    return TCPListener(cfg, SERVER, TCPListener::DEFAULT_BACKLOG, 0);
+}
+
+int main() {
+    try {
+        // a handshake completes without the listener holding any state until the final ACK
+        {
+            TCPListener listener = cookie_listener(1200);
+            deque<TCPTestClient> clients;
+            TCPTestClient &client = clients.emplace_back(CLIENT.port(), SERVER);
+            client.conn.connect();
+            to_listener(listener, client);
+            if (listener.connections() != 0 or listener.stats().cookies_sent != 1) {
+                throw runtime_error("SYN wasn't answered with a cookie");
+            }
+
+            if (to_clients(listener, clients, CLIENT.port()).datagrams != 1 or not client.conn.active() or
+                client.conn.state() != TCPState::State::ESTABLISHED) {
+                throw runtime_error("client didn't take the cookie");
+            }
+            client.conn.write("hello");
+            to_listener(listener, client);
+            const optional<FourTuple> tuple = listener.accept();
+            if (not tuple.has_value() or listener.stats().cookies_accepted != 1) {
+                throw runtime_error("valid cookie didn't make a connection");
+            }
+            TCPConnection &server = *listener.connection(tuple.value());
+            if (server.state() != TCPState::State::ESTABLISHED or server.inbound_stream().read(100) != "hello") {
+                throw runtime_error("connection made from a cookie isn't established");
+            }
+
+            to_clients(listener, clients, CLIENT.port());
+
+            // the cookie carried the max payload size: 1200 rounds down to 1000
+            server.write(string(3000, 'x'));
+            listener.flush(tuple.value());
+            if (listener.datagrams_out().size() != 3 or
+                client.adapter.unwrap_tcp_in_ip(reparse(listener.datagrams_out().front()))->payload().size() != 1000) {
+                throw runtime_error("connection made from a cookie has the wrong max payload size");
+            }
+            to_clients(listener, clients, CLIENT.port());
+            if (client.conn.inbound_stream().buffer_size() != 3000) {
+                throw runtime_error("reply didn't reach the client");
+            }
+            client.conn.inbound_stream().pop_output(3000);
+            client.conn.write("bye");
+            to_listener(listener, client);
+            if (server.inbound_stream().read(100) != "bye") {
+                throw runtime_error("ACK that follows the cookie's was mistaken for one");
+            }
+        }
+
+        // a SYN flood allocates nothing
+        {
+            TCPListener listener = cookie_listener();
+            TCPTestClient client{CLIENT.port(), SERVER};
+            for (uint16_t port = 20000; port < 21000; port++) {
+                client.adapter.config_mut().source = {CLIENT.ip(), port};
+                TCPSegment syn;
+                syn.header().syn = true;
+                syn.header().seqno = WrappingInt32{port * 7919u};
+                listener.datagram_received(reparse(client.adapter.wrap_tcp_in_ip(syn)));
+            }
+            if (listener.connections() != 0 or listener.stats().cookies_sent != 1000 or
+                listener.datagrams_out().size() != 1000) {
+                throw runtime_error("SYN flood allocated connections");
+            }
+        }
+
+        // a forged or stale cookie gets a RST
+        for (const bool stale : {false, true}) {
+            TCPListener listener = cookie_listener();
+            deque<TCPTestClient> clients;
+            TCPTestClient &client = clients.emplace_back(CLIENT.port(), SERVER);
+            client.conn.connect();
+            to_listener(listener, client);
+            TCPSegment syn_ack = client.adapter.unwrap_tcp_in_ip(reparse(listener.datagrams_out().front())).value();
+            listener.datagrams_out().pop();
+            if (stale) {
+                listener.tick(2 * TCPListener::COOKIE_PERIOD);
+            } else {
+                syn_ack.header().seqno = syn_ack.header().seqno + 1;
+            }
+            client.conn.segment_received(syn_ack);
+            to_listener(listener, client);
+            const TCPExchangeResult reply = to_clients(listener, clients, CLIENT.port());
+            if (listener.connections() != 0 or reply.datagrams != 1 or reply.resets != 1) {
+                throw runtime_error(string(stale ? "stale" : "forged") + " cookie wasn't reset");
+            }
+        }
+
+        // without cookies, a full SYN queue drops the SYN
+        {
+            TCPListener listener(TCPConfig{}, SERVER, TCPListener::DEFAULT_BACKLOG, 0);
+            TCPTestClient client{CLIENT.port(), SERVER};
+            client.conn.connect();
+            to_listener(listener, client);
+            if (not listener.datagrams_out().empty() or listener.stats().syn_queue_drops != 1) {
+                throw runtime_error("SYN answered with cookies off");
+            }
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
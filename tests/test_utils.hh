@@ -1,13 +1,18 @@
 #ifndef SPONGE_TESTS_TEST_UTILS_HH
 #define SPONGE_TESTS_TEST_UTILS_HH
 
+#include "buffer.hh"
 #include "tcp_header.hh"
 #include "util.hh"
 
+#include <chrono>
 #include <cstdint>
 #include <iomanip>
 #include <iostream>
 #include <pcap/pcap.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
 
 inline void show_ethernet_frame(const uint8_t *pkt, const struct pcap_pkthdr &hdr) {
     const auto flags(std::cout.flags());
@@ -39,4 +44,33 @@ inline bool compare_tcp_headers(const TCPHeader &h1, const TCPHeader &h2) {
     return compare_tcp_headers_nolen(h1, h2) && h1.doff == h2.doff;
 }
 
+//! \brief Parse each of `packets` repeatedly and print the parse throughput
+//! \details `parse_one` takes a Buffer and returns `true` on success; successes are counted (and checked)
+//! so the parsing can't be optimized away.
+template <typename ParseOne>
+void report_parse_throughput(const std::string &what, const std::vector<Buffer> &packets, ParseOne &&parse_one) {
+    constexpr unsigned rounds = 256;
+
+    size_t successes = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < rounds; ++i) {
+        for (const auto &packet : packets) {
+            successes += parse_one(packet);
+        }
+    }
+    const auto stop = std::chrono::steady_clock::now();
+
+    if (successes != size_t(rounds) * packets.size()) {
+        throw std::runtime_error(what + " benchmark: a packet that parsed before failed to parse");
+    }
+
+    const double seconds = std::chrono::duration<double>(stop - start).count();
+    const size_t parses = rounds * packets.size();
+    const auto flags(std::cout.flags());
+    std::cout << what << " parse throughput: " << std::fixed << std::setprecision(2)
+              << (seconds > 0 ? parses / seconds / 1e6 : 0.0) << " Mpkt/s (" << parses << " parses in "
+              << seconds * 1e3 << " ms)\n";
+    std::cout.flags(flags);
+}
+
 #endif  // SPONGE_TESTS_TEST_UTILS_HH
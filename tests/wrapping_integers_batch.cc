@@ -0,0 +1,69 @@
+#include "util.hh"
+#include "wrapping_integers.hh"
+
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// wrap() and unwrap() can be evaluated at compile time
+static_assert(wrap(3ul << 32 | 5, WrappingInt32{10}) == WrappingInt32{15});
+static_assert(unwrap(WrappingInt32{15}, WrappingInt32{16}, 0) == UINT32_MAX);
+static_assert(unwrap(WrappingInt32{1}, WrappingInt32{0}, UINT32_MAX) == (1ul << 32) + 1);
+static_assert(unwrap(WrappingInt32{UINT32_MAX}, WrappingInt32{0}, 3ul << 32) == (3ul << 32) - 1);
+// exactly halfway between two candidates, the later one is closest
+static_assert(unwrap(WrappingInt32{1u << 31}, WrappingInt32{0}, 1ul << 32) == 3ul << 31);
+
+static void check_batch(const vector<WrappingInt32> &seqnos, const WrappingInt32 isn, const uint64_t checkpoint) {
+    vector<uint64_t> absolute(seqnos.size());
+    unwrap_n(seqnos.data(), seqnos.size(), isn, checkpoint, absolute.data());
+    for (size_t i = 0; i < seqnos.size(); i++) {
+        if (absolute[i] != unwrap(seqnos[i], isn, checkpoint)) {
+            throw runtime_error("unwrap_n disagrees with unwrap for seqno " + to_string(seqnos[i].raw_value()) +
+                                ", isn " + to_string(isn.raw_value()) + " and checkpoint " + to_string(checkpoint));
+        }
+    }
+}
+
+int main() {
+    try {
+        auto rd = get_random_generator();
+        uniform_int_distribution<uint32_t> dist32{0, numeric_limits<uint32_t>::max()};
+        uniform_int_distribution<uint64_t> dist63{0, uint64_t{1} << 63};
+
+        // nothing to do
+        check_batch({}, WrappingInt32{0}, 0);
+
+        // a window's worth of seqnos either side of the checkpoint, including near zero
+        for (const uint64_t checkpoint : {uint64_t{0}, uint64_t{1000}, uint64_t{1} << 32, dist63(rd)}) {
+            const WrappingInt32 isn{dist32(rd)};
+            vector<WrappingInt32> seqnos;
+            for (uint32_t offset = 0; offset < 4096; offset++) {
+                seqnos.push_back(wrap(checkpoint, isn) + offset * 1000);
+                seqnos.push_back(wrap(checkpoint, isn) - offset * 1000);
+            }
+            check_batch(seqnos, isn, checkpoint);
+        }
+
+        // and anywhere at all
+        for (unsigned int i = 0; i < 1000; i++) {
+            vector<WrappingInt32> seqnos(64, WrappingInt32{0});
+            for (auto &seqno : seqnos) {
+                seqno = WrappingInt32{dist32(rd)};
+            }
+            check_batch(seqnos, WrappingInt32{dist32(rd)}, dist63(rd));
+        }
+    } catch (const exception &e) {
+        cerr << "Exception: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}